@@ -1,9 +1,44 @@
+#if !defined(_POSIX_C_SOURCE) && (defined(__unix__) || defined(__APPLE__))
+#define _POSIX_C_SOURCE 200809L // write() and friends aren't declared under plain -std=c99 otherwise
+#endif
 #include "CJsonWrite/CJsonWrite.h"
 #ifndef __cplusplus
 #include <stdbool.h>
 #endif
+#if JSON_ENABLE_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if JSON_ENABLE_THREADS
+#include <pthread.h>
+#endif
+#if JSON_ENABLE_SIMD && defined(__AVX2__)
+#define JSON_ESCAPE_AVX2 1
+#include <immintrin.h>
+#elif JSON_ENABLE_SIMD && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define JSON_ESCAPE_SSE2 1
+#include <emmintrin.h>
+#endif
+#if (defined(JSON_ESCAPE_AVX2) || defined(JSON_ESCAPE_SSE2)) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 JSONFuncs_t jsonFuncs;
+static void JSONKeyTableDestroy(JSONContext_t* pCtx);
+// The context used by every function that doesn't take one. CJsonWriteInit sets it up.
+static JSONContext_t defaultContext;
+/// @brief Stands in for memcpy in function tables that don't set it (it was added after the others, so older setups leave it NULL).
+static void* JSONCopyBytes(void* pDest, const void* pSrc, size_t size) {
+    char* pDestBytes = (char*)pDest;
+    const char* pSrcBytes = (const char*)pSrc;
+    for (size_t i = 0; i < size; i++) {
+        pDestBytes[i] = pSrcBytes[i];
+    }
+    return pDest;
+}
 void CJsonWriteInit(JSONFuncs_t* _jsonFuncs) {
     jsonFuncs.malloc = _jsonFuncs->malloc;
     jsonFuncs.free = _jsonFuncs->free;
@@ -11,7 +46,505 @@ void CJsonWriteInit(JSONFuncs_t* _jsonFuncs) {
     jsonFuncs.strlen = _jsonFuncs->strlen;
     jsonFuncs.snprintf = _jsonFuncs->snprintf;
     jsonFuncs.strncpy = _jsonFuncs->strncpy;
+    jsonFuncs.memcpy = _jsonFuncs->memcpy != NULL ? _jsonFuncs->memcpy : JSONCopyBytes;
+    jsonFuncs.strtod = _jsonFuncs->strtod;
+
+    JSONContextInit(&defaultContext, &jsonFuncs);
+}
+
+#pragma region CONTEXT
+/// @brief Initializes a context: a function table plus its own allocator state (node pool, arena) and scratch buffer.
+/// Trees created through different contexts share nothing, so each thread can build and dump with its own context without any locking.
+/// @param pCtx The context
+/// @param pFuncs The functions this context uses. They get copied. memcpy and strtod may be NULL.
+void JSONContextInit(JSONContext_t* pCtx, const JSONFuncs_t* pFuncs) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(pFuncs != NULL);
+    JsonAssertMsg(pFuncs->malloc != NULL && pFuncs->free != NULL && pFuncs->memset != NULL && pFuncs->strlen != NULL && pFuncs->snprintf != NULL && pFuncs->strncpy != NULL,
+        "A required function of the JSONFuncs_t is missing !");
+    pCtx->funcs = *pFuncs;
+    if (pCtx->funcs.memcpy == NULL) {
+        pCtx->funcs.memcpy = JSONCopyBytes;
+    }
+#if JSON_ENABLE_STATS
+    (void)pCtx->funcs.memset(&pCtx->stats, 0, sizeof(JSONStats_t));
+    pCtx->statsClock = NULL;
+    pCtx->dumpCallback = NULL;
+    pCtx->pDumpCallbackData = NULL;
+#endif
+    pCtx->pArena = NULL;
+    pCtx->pPool = NULL;
+#if JSON_NODE_POOL_SLAB_SIZE > 0
+    JSONCtxNodePoolInit(pCtx, &pCtx->pool, JSON_NODE_POOL_SLAB_SIZE);
+    pCtx->pPool = &pCtx->pool;
+#endif
+    JSONCtxBufferInit(pCtx, &pCtx->scratch, 0);
+    pCtx->keys.ppBuckets = NULL;
+    pCtx->keys.bucketCount = 0;
+    pCtx->keys.keyCount = 0;
+    pCtx->bInternKeys = JSON_INTERN_KEYS;
+    pCtx->maxDepth = JSON_MAX_DEPTH;
+}
+/// @brief Releases what a context owns: its node pool, scratch buffer and interned keys. Every node created through it must have been destroyed first.
+/// @param pCtx The context
+void JSONContextDestroy(JSONContext_t* pCtx) {
+    JsonAssert(pCtx != NULL);
+#if JSON_NODE_POOL_SLAB_SIZE > 0
+    JSONNodePoolDestroy(&pCtx->pool);
+#endif
+    JSONBufferDestroy(&pCtx->scratch);
+    JSONKeyTableDestroy(pCtx);
+    pCtx->pPool = NULL;
+    pCtx->pArena = NULL;
+}
+/// @brief Sets how deeply objects/arrays can be nested in the trees of this context for them to be dumped. Deeper dumps fail.
+void JSONCtxSetMaxDepth(JSONContext_t* pCtx, size_t maxDepth) {
+    JsonAssert(pCtx != NULL);
+    pCtx->maxDepth = maxDepth;
+}
+/// @brief The context every function without a pCtx parameter uses (i.e. the one set up by CJsonWriteInit).
+JSONContext_t* JSONGetDefaultContext() {
+    return &defaultContext;
+}
+#pragma endregion
+
+#pragma region STATS
+// Every allocation the library makes goes through JSONCtxAlloc/JSONCtxRelease, so that with JSON_ENABLE_STATS on, the context knows how many bytes are live.
+// With it off, those are just the context's malloc/free and the other JSONStats* helpers are empty, so it all compiles away.
+
+/// @brief Stops counting bytes: they were freed, or handed over to the caller (like a dump's output, which the caller frees).
+static void JSONStatsForgetBytes(JSONContext_t* pCtx, size_t size) {
+#if JSON_ENABLE_STATS
+    pCtx->stats.liveBytes -= size;
+#else
+    (void)pCtx;
+    (void)size;
+#endif
+}
+static void JSONStatsNodeAdded(JSONContext_t* pCtx, JSONType_t type) {
+#if JSON_ENABLE_STATS
+    if ((size_t)type < JSON_TYPE_COUNT) {
+        pCtx->stats.nodeCounts[type]++;
+    }
+    pCtx->stats.liveNodes++;
+    if (pCtx->stats.liveNodes > pCtx->stats.peakNodes) {
+        pCtx->stats.peakNodes = pCtx->stats.liveNodes;
+    }
+#else
+    (void)pCtx;
+    (void)type;
+#endif
+}
+static void JSONStatsNodeRemoved(JSONContext_t* pCtx, JSONType_t type) {
+#if JSON_ENABLE_STATS
+    if ((size_t)type < JSON_TYPE_COUNT) {
+        pCtx->stats.nodeCounts[type]--;
+    }
+    pCtx->stats.liveNodes--;
+#else
+    (void)pCtx;
+    (void)type;
+#endif
+}
+/// @brief Records that a dump into pBuffer opened its depth-th nested object/array.
+static void JSONStatsDepthReached(JSONBuffer_t* pBuffer, size_t depth) {
+#if JSON_ENABLE_STATS
+    if (depth > pBuffer->maxDepth) {
+        pBuffer->maxDepth = depth;
+    }
+#else
+    (void)pBuffer;
+    (void)depth;
+#endif
+}
+
+#if JSON_ENABLE_STATS
+/// @brief Counts an allocation of size bytes.
+static void JSONStatsCountAlloc(JSONStats_t* pStats, size_t size) {
+    pStats->allocCount++;
+    pStats->liveBytes += size;
+    if (pStats->liveBytes > pStats->peakBytes) {
+        pStats->peakBytes = pStats->liveBytes;
+    }
+}
+#endif
+/// @brief Allocates through the context's malloc.
+/// @param size The number of bytes. Must be passed to JSONCtxRelease again.
+static void* JSONCtxAlloc(JSONContext_t* pCtx, size_t size) {
+    void* p = pCtx->funcs.malloc(size);
+#if JSON_ENABLE_STATS
+    if (p != NULL) {
+        JSONStatsCountAlloc(&pCtx->stats, size);
+    }
+#endif
+    return p;
+}
+/// @brief Frees something allocated with JSONCtxAlloc.
+/// @param size The size it was allocated with
+static void JSONCtxRelease(JSONContext_t* pCtx, void* p, size_t size) {
+    pCtx->funcs.free(p);
+    JSONStatsForgetBytes(pCtx, size);
+}
+
+#if JSON_ENABLE_STATS
+static uint64_t JSONStatsNow(JSONContext_t* pCtx) {
+    return pCtx->statsClock != NULL ? pCtx->statsClock() : 0;
+}
+/// @brief Records a finished dump, and tells the dump callback about it.
+/// @param start The clock when the dump started
+/// @param sized The clock when the output was ready to be written to
+static void JSONStatsDumpDone(JSONContext_t* pCtx, uint64_t start, uint64_t sized, size_t length, size_t maxDepth, bool bFailed) {
+    JSONDumpStats_t* pDump = &pCtx->stats.lastDump;
+    pDump->length = bFailed ? 0 : length;
+    pDump->maxDepth = maxDepth;
+    pDump->sizingTime = sized - start;
+    pDump->writingTime = JSONStatsNow(pCtx) - sized;
+    pDump->bFailed = bFailed;
+
+    pCtx->stats.dumpCount++;
+    if (bFailed) {
+        pCtx->stats.failedDumpCount++;
+    }
+    pCtx->stats.dumpedBytes += pDump->length;
+    if (maxDepth > pCtx->stats.maxDepth) {
+        pCtx->stats.maxDepth = maxDepth;
+    }
+    if (pCtx->dumpCallback != NULL) {
+        pCtx->dumpCallback(pCtx->pDumpCallbackData, pDump);
+    }
+}
+
+/// @brief Gets the counters of a context. Only reads are safe while other threads use the context, and they may see counters mid-update.
+const JSONStats_t* JSONCtxGetStats(JSONContext_t* pCtx) {
+    JsonAssert(pCtx != NULL);
+    return &pCtx->stats;
+}
+/// @brief Restarts the peaks and totals of a context from now. Live counts (nodes, bytes) carry on, since what they count is still there.
+void JSONCtxResetStats(JSONContext_t* pCtx) {
+    JsonAssert(pCtx != NULL);
+    JSONStats_t* pStats = &pCtx->stats;
+    pStats->peakNodes = pStats->liveNodes;
+    pStats->peakBytes = pStats->liveBytes;
+    pStats->allocCount = 0;
+    pStats->dumpCount = 0;
+    pStats->failedDumpCount = 0;
+    pStats->dumpedBytes = 0;
+    pStats->maxDepth = 0;
+    (void)pCtx->funcs.memset(&pStats->lastDump, 0, sizeof(JSONDumpStats_t));
+}
+/// @brief Sets the clock dumps get timed with: any monotonic counter works (nanoseconds, CPU cycles, RTOS ticks...). NULL to stop timing.
+void JSONCtxSetStatsClock(JSONContext_t* pCtx, JSONStatsClock_t clock) {
+    JsonAssert(pCtx != NULL);
+    pCtx->statsClock = clock;
+}
+/// @brief Sets a function that gets called at the end of every dump of a tree of this context, with what the dump did. NULL to remove it.
+void JSONCtxSetDumpCallback(JSONContext_t* pCtx, JSONDumpCallback_t callback, void* pUserData) {
+    JsonAssert(pCtx != NULL);
+    pCtx->dumpCallback = callback;
+    pCtx->pDumpCallbackData = pUserData;
+}
+#endif
+#pragma endregion
+
+// A length of JSON_LENGTH_OVERFLOW means "too big for a size_t". It can't be a real length (there'd be no room left for a null terminator),
+// and since sums saturate it sticks through every sum it's part of, up to the root. Dumps check for it instead of writing with wrapped lengths.
+#define JSON_LENGTH_OVERFLOW SIZE_MAX
+
+/// @brief Adds two lengths, saturating at JSON_LENGTH_OVERFLOW instead of silently wrapping around if the sum doesn't fit in a size_t.
+static size_t JSONAddLengths(size_t a, size_t b) {
+    if (a > SIZE_MAX - b) return JSON_LENGTH_OVERFLOW;
+    return a + b;
+}
+/// @brief Multiplies a count by an element size, saturating at SIZE_MAX like JSONAddLengths.
+/// No allocator can hand out SIZE_MAX bytes, so an allocation of that size fails the normal way instead of coming back too small.
+static size_t JSONMulLengths(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) return SIZE_MAX;
+    return count * size;
+}
+
+#pragma region ARENA
+
+// Every arena allocation is aligned to this, which is enough for anything a JSONNode holds
+typedef union JSONArenaAlign {
+    void* p;
+    double d;
+    uint64_t u;
+} JSONArenaAlign_t;
+#define JSON_ARENA_ALIGNMENT sizeof(JSONArenaAlign_t)
+#define JSON_ARENA_ALIGN_UP(size) (((size) + JSON_ARENA_ALIGNMENT - 1) & ~(JSON_ARENA_ALIGNMENT - 1))
+
+/// @brief Header of each chunk of an arena. The chunk's memory follows right after it.
+struct JSONArenaChunk {
+    struct JSONArenaChunk* pNext;
+    size_t used;
+    size_t capacity;
+};
+#define JSON_ARENA_HEADER_SIZE JSON_ARENA_ALIGN_UP(sizeof(struct JSONArenaChunk))
+
+static struct JSONArenaChunk* JSONArenaNewChunk(JSONArena_t* pArena, size_t capacity) {
+    struct JSONArenaChunk* pChunk = (struct JSONArenaChunk*)JSONCtxAlloc(pArena->pCtx, JSON_ARENA_HEADER_SIZE + capacity);
+    JsonAssert(pChunk != NULL);
+    pChunk->pNext = NULL;
+    pChunk->used = 0;
+    pChunk->capacity = capacity;
+    return pChunk;
+}
+/// @brief Initializes an arena. Nothing is allocated until the first allocation.
+/// @param pCtx The context whose malloc/free the arena's chunks come from
+/// @param pArena The arena
+/// @param chunkSize The size of each chunk the arena grabs from malloc (0 for JSON_ARENA_DEFAULT_CHUNK_SIZE)
+void JSONCtxArenaInit(JSONContext_t* pCtx, JSONArena_t* pArena, size_t chunkSize) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(pArena != NULL);
+    pArena->pCtx = pCtx;
+    pArena->pFirstChunk = NULL;
+    pArena->pCurrentChunk = NULL;
+    pArena->chunkSize = chunkSize > 0 ? JSON_ARENA_ALIGN_UP(chunkSize) : JSON_ARENA_DEFAULT_CHUNK_SIZE;
 }
+/// @brief Bump-allocates memory from an arena. It only ever gets released all at once, by JSONArenaReset or JSONArenaDestroy.
+/// @param pArena The arena
+/// @param size The number of bytes
+/// @return The memory, NULL if it couldn't be allocated (like malloc, that includes sizes too big for a chunk's size to fit in a size_t)
+void* JSONArenaAlloc(JSONArena_t* pArena, size_t size) {
+    JsonAssert(pArena != NULL);
+    if (size > SIZE_MAX - JSON_ARENA_HEADER_SIZE - JSON_ARENA_ALIGNMENT) return NULL;
+    size = JSON_ARENA_ALIGN_UP(size);
+
+    struct JSONArenaChunk* pChunk = pArena->pCurrentChunk;
+    if (pChunk == NULL || pChunk->capacity - pChunk->used < size) {
+        // chunks kept by a previous reset get reused before allocating new ones
+        if (pChunk != NULL && pChunk->pNext != NULL && pChunk->pNext->capacity >= size) {
+            pChunk = pChunk->pNext;
+            pChunk->used = 0;
+        } else {
+            struct JSONArenaChunk* pNewChunk = JSONArenaNewChunk(pArena, size > pArena->chunkSize ? size : pArena->chunkSize);
+            if (pChunk == NULL) {
+                pNewChunk->pNext = pArena->pFirstChunk;
+                pArena->pFirstChunk = pNewChunk;
+            } else {
+                pNewChunk->pNext = pChunk->pNext;
+                pChunk->pNext = pNewChunk;
+            }
+            pChunk = pNewChunk;
+        }
+        pArena->pCurrentChunk = pChunk;
+    }
+
+    void* pMemory = (char*)pChunk + JSON_ARENA_HEADER_SIZE + pChunk->used;
+    pChunk->used += size;
+    return pMemory;
+}
+/// @brief Releases everything allocated from an arena in one go (i.e. every tree built in it). Its chunks are kept around for the next trees.
+/// @param pArena The arena
+void JSONArenaReset(JSONArena_t* pArena) {
+    JsonAssert(pArena != NULL);
+    if (pArena->pFirstChunk == NULL) return;
+    pArena->pFirstChunk->used = 0;
+    pArena->pCurrentChunk = pArena->pFirstChunk;
+}
+/// @brief Releases everything allocated from an arena and gives its chunks back to its context's free.
+/// @param pArena The arena
+void JSONArenaDestroy(JSONArena_t* pArena) {
+    JsonAssert(pArena != NULL);
+    JsonAssertMsg(pArena->pCtx->pArena != pArena, "Tried to destroy the active arena ! Call JSONSetArena(NULL) first.");
+
+    struct JSONArenaChunk* pChunk = pArena->pFirstChunk;
+    while (pChunk != NULL) {
+        struct JSONArenaChunk* pNext = pChunk->pNext;
+        JSONCtxRelease(pArena->pCtx, pChunk, JSON_ARENA_HEADER_SIZE + pChunk->capacity);
+        pChunk = pNext;
+    }
+    pArena->pFirstChunk = NULL;
+    pArena->pCurrentChunk = NULL;
+}
+void JSONArenaInit(JSONArena_t* pArena, size_t chunkSize) {
+    JSONCtxArenaInit(&defaultContext, pArena, chunkSize);
+}
+/// @brief Sets the arena that every node created through a context from now on gets allocated from. Pass NULL to go back to the pool/malloc.
+/// Nodes remember where they came from, so JSONNodeDestroy never frees arena memory; the whole tree goes away with JSONArenaReset instead.
+/// @param pCtx The context
+/// @param pArena The arena, or NULL. Must have been initialized with the same context.
+void JSONCtxSetArena(JSONContext_t* pCtx, JSONArena_t* pArena) {
+    JsonAssert(pCtx != NULL);
+    JsonAssertMsg(pArena == NULL || pArena->pCtx == pCtx, "Tried to use an arena with a different context than the one it was initialized with !");
+    pCtx->pArena = pArena;
+}
+JSONArena_t* JSONCtxGetArena(JSONContext_t* pCtx) {
+    JsonAssert(pCtx != NULL);
+    return pCtx->pArena;
+}
+void JSONSetArena(JSONArena_t* pArena) {
+    JSONCtxSetArena(&defaultContext, pArena);
+}
+JSONArena_t* JSONGetArena() {
+    return defaultContext.pArena;
+}
+#pragma endregion
+
+#pragma region NODE_POOL
+/// @brief Header of each slab of a node pool. The slab's nodes follow right after it.
+struct JSONNodeSlab {
+    struct JSONNodeSlab* pNext;
+    JSONNode_t nodes[1];
+};
+#define JSON_NODE_SLAB_BYTES(nodesPerSlab) (sizeof(struct JSONNodeSlab) + ((nodesPerSlab) - 1) * sizeof(JSONNode_t))
+
+/// @brief Initializes a node pool. Nothing is allocated until the first node.
+/// @param pCtx The context whose malloc/free the pool's slabs come from
+/// @param pPool The pool
+/// @param nodesPerSlab How many nodes to allocate at once (0 for JSON_NODE_POOL_DEFAULT_SLAB_SIZE)
+void JSONCtxNodePoolInit(JSONContext_t* pCtx, JSONNodePool_t* pPool, size_t nodesPerSlab) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(pPool != NULL);
+    pPool->pCtx = pCtx;
+    pPool->pSlabs = NULL;
+    pPool->pFreeList = NULL;
+    pPool->nodesPerSlab = nodesPerSlab > 0 ? nodesPerSlab : JSON_NODE_POOL_DEFAULT_SLAB_SIZE;
+}
+void JSONNodePoolInit(JSONNodePool_t* pPool, size_t nodesPerSlab) {
+    JSONCtxNodePoolInit(&defaultContext, pPool, nodesPerSlab);
+}
+/// @brief Gives every slab of a pool back to its context's free. Every node that came from the pool must have been destroyed first.
+/// @param pPool The pool
+void JSONNodePoolDestroy(JSONNodePool_t* pPool) {
+    JsonAssert(pPool != NULL);
+    struct JSONNodeSlab* pSlab = pPool->pSlabs;
+    while (pSlab != NULL) {
+        struct JSONNodeSlab* pNext = pSlab->pNext;
+        JSONCtxRelease(pPool->pCtx, pSlab, JSON_NODE_SLAB_BYTES(pPool->nodesPerSlab));
+        pSlab = pNext;
+    }
+    pPool->pSlabs = NULL;
+    pPool->pFreeList = NULL;
+}
+/// @brief Sets the pool that nodes created through a context get allocated from (when no arena is active). Pass NULL to allocate every node with malloc.
+/// Pool nodes remember their pool and always go back to it, whichever pool is active when they get destroyed, so keep a pool alive until every node that came from it is gone.
+/// @param pCtx The context
+/// @param pPool The pool, or NULL. Must have been initialized with the same context.
+void JSONCtxSetNodePool(JSONContext_t* pCtx, JSONNodePool_t* pPool) {
+    JsonAssert(pCtx != NULL);
+    JsonAssertMsg(pPool == NULL || pPool->pCtx == pCtx, "Tried to use a node pool with a different context than the one it was initialized with !");
+    pCtx->pPool = pPool;
+}
+JSONNodePool_t* JSONCtxGetNodePool(JSONContext_t* pCtx) {
+    JsonAssert(pCtx != NULL);
+    return pCtx->pPool;
+}
+void JSONSetNodePool(JSONNodePool_t* pPool) {
+    JSONCtxSetNodePool(&defaultContext, pPool);
+}
+JSONNodePool_t* JSONGetNodePool() {
+    return defaultContext.pPool;
+}
+/// @brief Adds a new slab to a pool. Its nodes aren't on the free list yet.
+static struct JSONNodeSlab* JSONNodePoolNewSlab(JSONNodePool_t* pPool) {
+    struct JSONNodeSlab* pSlab = (struct JSONNodeSlab*)JSONCtxAlloc(pPool->pCtx, JSON_NODE_SLAB_BYTES(pPool->nodesPerSlab));
+    JsonAssert(pSlab != NULL);
+    pSlab->pNext = pPool->pSlabs;
+    pPool->pSlabs = pSlab;
+    return pSlab;
+}
+static JSONNode_t* JSONNodePoolAlloc(JSONNodePool_t* pPool) {
+    if (pPool->pFreeList == NULL) {
+        size_t n = pPool->nodesPerSlab;
+        struct JSONNodeSlab* pSlab = JSONNodePoolNewSlab(pPool);
+
+        // thread the free list front to back so consecutive nodes end up next to each other in memory
+        for (size_t i = 0; i < n; i++) {
+            pSlab->nodes[i].pNextSibling = i + 1 < n ? &pSlab->nodes[i + 1] : NULL;
+        }
+        pPool->pFreeList = &pSlab->nodes[0];
+    }
+    JSONNode_t* pNode = pPool->pFreeList;
+    pPool->pFreeList = pNode->pNextSibling;
+    return pNode;
+}
+static void JSONNodePoolFree(JSONNodePool_t* pPool, JSONNode_t* pNode) {
+    pNode->pNextSibling = pPool->pFreeList;
+    pPool->pFreeList = pNode;
+}
+
+/// @brief Allocates a node from the context's active arena if there is one, from its active pool if there is one, from its malloc otherwise.
+/// @param pCtx The context
+/// @param pFlags Receives the JSON_NODE_FLAG_* telling where the node came from
+/// @param ppPool Receives the pool the node came from (NULL if it didn't come from one), which it has to go back to
+static JSONNode_t* JSONNodeAlloc(JSONContext_t* pCtx, uint8_t* pFlags, JSONNodePool_t** ppPool) {
+    JSONNode_t* pNode;
+    *ppPool = NULL;
+    if (pCtx->pArena != NULL) {
+        pNode = (JSONNode_t*)JSONArenaAlloc(pCtx->pArena, sizeof(JSONNode_t));
+        *pFlags = JSON_NODE_FLAG_ARENA;
+    } else if (pCtx->pPool != NULL) {
+        pNode = JSONNodePoolAlloc(pCtx->pPool);
+        *pFlags = JSON_NODE_FLAG_POOL;
+        *ppPool = pCtx->pPool;
+    } else {
+        pNode = (JSONNode_t*)JSONCtxAlloc(pCtx, sizeof(JSONNode_t));
+        *pFlags = 0;
+    }
+    JsonAssert(pNode != NULL);
+    return pNode;
+}
+/// @brief Hands out the nodes of a batch of known size as contiguously as the context allows: one block when an arena is active,
+/// whole fresh slabs (without going through the free list) when a pool is, one malloc per node otherwise (each has to be freeable on its own).
+typedef struct JSONNodeBatch {
+    JSONNode_t* pBlock; // next node of the current block
+    size_t blockLeft;
+    size_t left; // nodes of the batch not handed out yet
+    uint8_t flags;
+    JSONNodePool_t* pPool; // the pool the nodes come from, if they do
+} JSONNodeBatch_t;
+
+static void JSONNodeBatchInit(JSONContext_t* pCtx, JSONNodeBatch_t* pBatch, size_t count) {
+    pBatch->pBlock = NULL;
+    pBatch->blockLeft = 0;
+    pBatch->left = count;
+    pBatch->pPool = NULL;
+    if (pCtx->pArena != NULL) {
+        pBatch->pBlock = (JSONNode_t*)JSONArenaAlloc(pCtx->pArena, JSONMulLengths(count, sizeof(JSONNode_t)));
+        JsonAssert(pBatch->pBlock != NULL);
+        pBatch->blockLeft = count;
+        pBatch->flags = JSON_NODE_FLAG_ARENA;
+    } else {
+        pBatch->flags = pCtx->pPool != NULL ? JSON_NODE_FLAG_POOL : 0;
+        pBatch->pPool = pCtx->pPool;
+    }
+}
+static JSONNode_t* JSONNodeBatchNext(JSONContext_t* pCtx, JSONNodeBatch_t* pBatch) {
+    JSONNode_t* pNode;
+    if (pBatch->blockLeft == 0 && pBatch->flags == JSON_NODE_FLAG_POOL) {
+        JSONNodePool_t* pPool = pBatch->pPool;
+        if (pPool->pFreeList == NULL && pBatch->left >= pPool->nodesPerSlab) {
+            pBatch->pBlock = JSONNodePoolNewSlab(pPool)->nodes;
+            pBatch->blockLeft = pPool->nodesPerSlab;
+        }
+    }
+
+    if (pBatch->blockLeft > 0) {
+        pNode = pBatch->pBlock++;
+        pBatch->blockLeft--;
+    } else if (pBatch->flags == JSON_NODE_FLAG_POOL) {
+        pNode = JSONNodePoolAlloc(pBatch->pPool);
+    } else {
+        pNode = (JSONNode_t*)JSONCtxAlloc(pCtx, sizeof(JSONNode_t));
+        JsonAssert(pNode != NULL);
+    }
+    pBatch->left--;
+    return pNode;
+}
+/// @brief Gives a node's memory back to wherever it came from: the pool it was allocated from (not whichever pool is active now),
+/// or its context's free. Arena nodes are left alone, they go away with the arena.
+static void JSONNodeFree(JSONNode_t* pNode) {
+    JSONContext_t* pCtx = pNode->pCtx;
+    JSONStatsNodeRemoved(pCtx, pNode->type);
+    if (pNode->flags & JSON_NODE_FLAG_ARENA) return;
+    if (pNode->flags & JSON_NODE_FLAG_POOL) {
+        JSONNodePoolFree(pNode->pPool, pNode);
+        return;
+    }
+    JSONCtxRelease(pCtx, pNode, sizeof(JSONNode_t));
+}
+#pragma endregion
 #pragma region VALIDATOR_UTILS
 bool JSONArrayIsValid(JSONArray_t* pArray) {
     if (pArray == NULL) return false;
@@ -29,7 +562,7 @@ bool JSONArrayIsEmpty(JSONArray_t* pArray) {
 bool JSONArrayNodeIsEmpty(JSONNode_t* pNode) {
     JsonAssert(pNode != NULL);
     JsonAssert(pNode->type == JSONArrayType);
-    return JSONArrayIsEmpty(pNode->value.pArray);
+    return JSONArrayIsEmpty(&pNode->value.array);
 }
 bool JSONObjIsValid(JSONObj_t* pObj) {
     if (pObj == NULL) return false;
@@ -44,19 +577,24 @@ bool JSONObjIsEmpty(JSONObj_t* pObj) {
     JSONObjMustBeValid(pObj);
     return pObj->pFirstChild == NULL; // checking pLastChild would work too because if only one is null then something terrible has happened
 }
+/// @brief Gets the number of elements of an array. O(1), arrays keep count as elements get added and removed.
 size_t JSONArrayGetNumElements(JSONArray_t* pArray) {
-    size_t n = 0;
-    JSONNode_t* current = pArray->pStart;
-    while (current != NULL) {
-        current = current->pNextSibling;
-        n++;
-    }
-    return n;
+    JSONArrayMustBeValid(pArray);
+    return pArray->count;
+}
+size_t JSONObjGetNumChildren(JSONObj_t* pObj) {
+    JSONObjMustBeValid(pObj);
+    return pObj->count;
 }
 bool JSONNodeCanHaveChildren(JSONNode_t* pNode) {
     JsonAssert(pNode != NULL);
     return pNode->type == JSONObjType || pNode->type == JSONArrayType;
 }
+/// @brief Whether a node is a packed int/float array. Those dump as arrays, but hold plain numbers instead of child nodes.
+bool JSONNodeIsPackedArray(JSONNode_t* pNode) {
+    JsonAssert(pNode != NULL);
+    return pNode->type == JSONIntArrayType || pNode->type == JSONFloatArrayType;
+}
 #pragma endregion
 
 #pragma region NODE_UTILS
@@ -75,6 +613,38 @@ void JSONNodeConnectNeighbors(JSONNode_t* pNode) {
     }
 }
 
+static size_t JSONNodeComputeValueLength(JSONNode_t* pNode);
+
+/// @brief Records that the dumped value of a node went from oldLength to newLength bytes.
+/// The node and all of its ancestors get their length adjusted by the difference and get marked dirty, so this costs O(depth), not O(tree size).
+/// A length that has overflowed can't be adjusted by a difference, so those nodes get their length recounted from their children instead.
+/// @param pNode The node whose value changed (for a child being added or removed, that's the parent)
+/// @param oldLength How many bytes the changed part used to take
+/// @param newLength How many bytes it takes now
+static void JSONNodeValueLengthChanged(JSONNode_t* pNode, size_t oldLength, size_t newLength) {
+    for (JSONNode_t* current = pNode; current != NULL; current = current->pParent) {
+        size_t previousLength = current->valueLength;
+        if (previousLength == JSON_LENGTH_OVERFLOW || oldLength == JSON_LENGTH_OVERFLOW || newLength == JSON_LENGTH_OVERFLOW) {
+            current->valueLength = JSONNodeComputeValueLength(current);
+        } else if (newLength >= oldLength) {
+            current->valueLength = JSONAddLengths(previousLength, newLength - oldLength);
+        } else {
+            current->valueLength = previousLength - (oldLength - newLength);
+        }
+        current->flags |= JSON_NODE_FLAG_DIRTY;
+        // for the parent, what changed is this node's value
+        oldLength = previousLength;
+        newLength = current->valueLength;
+    }
+}
+
+/// @brief Gets the first child of an object or the first element of an array (NULL if it's empty or not a container).
+static JSONNode_t* JSONNodeGetFirstChild(JSONNode_t* pNode) {
+    if (pNode->type == JSONObjType) return pNode->value.children.pFirstChild;
+    if (pNode->type == JSONArrayType) return pNode->value.array.pStart;
+    return NULL;
+}
+
 /// @brief Connects two nodes together, linking the leftmost node's next sibling node.
 /// @param pLeft The leftmost node to link with.
 /// @param pNewNode A node with no prior connections ready to be inserted.
@@ -94,611 +664,4306 @@ void JSONNodeInsertAfter(JSONNode_t* pLeft, JSONNode_t* pNewNode) {
 }
 #pragma endregion
 
-/// @brief Destroys all elements of a JSONArray.
-/// @param pArray The array
-void JSONArrayDestroyElements(JSONArray_t* pArray) {
-    JSONArrayMustBeValid(pArray);
-    
-    if (JSONArrayIsEmpty(pArray)) {
-        return;
-    }
-
-    JSONNode_t* current = pArray->pStart;
-    JSONNode_t* next;
+#pragma region NUMBER_FORMATTING
+// "00" "01" ... "99", so integers can be written two digits at a time
+static const char jsonDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+static const uint64_t jsonPowersOf10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
 
-    while (current != NULL) {
-        next = current->pNextSibling;
-        JSONNodeDestroy(current);
-        current = next;
+/// @brief Counts the decimal digits of an unsigned number (0 has one digit).
+static size_t JSONCountDigits(uint64_t value) {
+    // OR-ing in 1 makes 0 count as one digit without changing the result for anything else, since 10^n is always even
+    uint64_t v = value | 1;
+#if defined(__GNUC__) || defined(__clang__)
+    // log10(x) ~= log2(x) * 1233/4096, then correct the guess with a single table compare
+    size_t bits = 64 - (size_t)__builtin_clzll(v);
+    size_t guess = (bits * 1233) >> 12;
+    return guess + 1 - (v < jsonPowersOf10[guess]);
+#else
+    size_t digits = 1;
+    while (digits < 20 && v >= jsonPowersOf10[digits]) {
+        digits++;
     }
-    pArray->pStart = NULL;
-    pArray->pEnd = NULL;
+    return digits;
+#endif
 }
-/// @brief Destroys all children of a JSONObj.
-/// @param pArray The obj
-void JSONObjDestroyChildren(JSONObj_t* pObj) {
-    JSONObjMustBeValid(pObj);
-
-    JSONNode_t* current = pObj->pFirstChild;
-    JSONNode_t* next;
-
-    while (current != NULL) {
-        next = current->pNextSibling;
-        JSONNodeDestroy(current);
-        current = next;
+/// @brief Writes the digits of an unsigned number backwards, ending right before pEnd.
+static void JSONWriteDigits32(char* pEnd, uint32_t value) {
+    while (value >= 100) {
+        const char* pPair = jsonDigitPairs + (value % 100) * 2;
+        value /= 100;
+        *--pEnd = pPair[1];
+        *--pEnd = pPair[0];
+    }
+    if (value >= 10) {
+        const char* pPair = jsonDigitPairs + value * 2;
+        *--pEnd = pPair[1];
+        *--pEnd = pPair[0];
+    } else {
+        *--pEnd = (char)('0' + value);
     }
 }
-/// @brief Recursively destroys each JSONNode in the tree. Handles everything related to the destruction process of any kind of JSONNode. Should be called every time you need to dispose of a JSONNode. 
-/// @param pNode The node to destroy
-void JSONNodeDestroy(JSONNode_t* pNode) {
-    JsonAssert(pNode != NULL);
-    switch (pNode->type) {
-        case JSONArrayType: {
-            JSONArray_t* pArray = pNode->value.pArray;
-            if (!JSONArrayIsEmpty(pArray)) {
-                JSONArrayDestroyElements(pArray);
-            }
-            jsonFuncs.free(pArray);
-            break;
-        }
-        case JSONObjType: {
-            JSONObj_t* pObj = pNode->value.pChildren;
-            JSONObjMustBeValid(pObj);
-            if (pObj->pFirstChild != NULL) {
-                JSONObjDestroyChildren(pObj);
-            }
-            jsonFuncs.free(pObj);
-            break;
+static void JSONWriteDigits64(char* pEnd, uint64_t value) {
+    // peel off 32-bit sized chunks so most of the divisions are cheap 32-bit ones
+    while (value > 0xFFFFFFFFULL) {
+        uint32_t low = (uint32_t)(value % 100000000ULL);
+        value /= 100000000ULL;
+        for (int i = 0; i < 4; i++) {
+            const char* pPair = jsonDigitPairs + (low % 100) * 2;
+            low /= 100;
+            *--pEnd = pPair[1];
+            *--pEnd = pPair[0];
         }
-        default:
-            break;
     }
-    
-    JSONNodeConnectNeighbors(pNode);
-    jsonFuncs.free(pNode);
+    JSONWriteDigits32(pEnd, (uint32_t)value);
 }
 
-/// @brief Returns the Nth element of an array
-/// @param pArray The array
-/// @param n The index of the element
-/// @return The node at the specified index in the array
-JSONNode_t* JSONArrayGetNthNode(JSONArray_t* pArray, int_type n) {
-    JSONArrayMustBeValid(pArray);
-    JsonAssertMsg(n >= 0, "Tried to get a negative-th element of an array ! (what are you doing :sob:)");
-
-    JsonAssertMsg(!JSONArrayIsEmpty(pArray), "Tried to get an element in an empty array !");
-
-    JSONNode_t* current = pArray->pStart;
-    for (int i = 0; i < n; i++) {
-        current = current->pNextSibling;
-        JsonAssertMsg(current != NULL, "Array indexed out of range.");
+/// @brief Gets the number of characters JSONFormatInt writes for a value.
+/// @param value The value
+/// @return The length
+size_t JSONIntGetFormattedLength(int_type value) {
+    if (value < 0) {
+        return 1 + JSONCountDigits((uint64_t)0 - (uint64_t)(int64_t)value);
     }
-
-    return current;
+    return JSONCountDigits((uint64_t)value);
 }
-/// @brief Adds an element node to an array node
-/// @param pArrayNode The array node.
-/// @param pChild The child node.
-void JSONArrayNodeAddNode(JSONNode_t* pArrayNode, JSONNode_t* pChild) {
-    JsonAssert(pArrayNode != NULL);
-    JsonAssertMsg(pArrayNode->type == JSONArrayType, "Tried to add an array element to a node that wasn't an array ! (what are you doing :sob:)");
-
-    JSONArray_t* pArray = pArrayNode->value.pArray;
-
-    // Make sure everything is valid
-    JSONArrayMustBeValid(pArray);
-    JsonAssert(pChild != NULL);
-
-    // Make sure the node isn't already used in another array, and add the parent
-    JsonAssertMsg(pChild->pParent == NULL, "Tried to add an array element, but the child node already has a parent ! Nodes should only have one reference at all times.");
-    pChild->pParent = pArrayNode;
-
-    if (JSONArrayIsEmpty(pArray)) {
-        pArray->pStart = pChild;
-        pArray->pEnd = pChild;
+/// @brief Formats an int_type in base 10. Doesn't depend on jsonFuncs.snprintf (or on the locale), and works for every int_type width from int8_t to int64_t.
+/// @param pOut Where to write the characters. Must have room for at least JSON_INT_MAX_CHARS characters. Not null-terminated.
+/// @param value The value
+/// @return The number of characters written
+size_t JSONFormatInt(char* pOut, int_type value) {
+    size_t length = 0;
+    if (value < 0) {
+        *pOut++ = '-';
+        length++;
+    }
+    if (sizeof(int_type) <= sizeof(uint32_t)) {
+        uint32_t magnitude = value < 0 ? 0U - (uint32_t)value : (uint32_t)value;
+        size_t digits = JSONCountDigits(magnitude);
+        JSONWriteDigits32(pOut + digits, magnitude);
+        return length + digits;
     } else {
-        JSONNodeInsertAfter(pArray->pEnd, pChild);
-        pArray->pEnd = pChild;
+        uint64_t magnitude = value < 0 ? (uint64_t)0 - (uint64_t)(int64_t)value : (uint64_t)value;
+        size_t digits = JSONCountDigits(magnitude);
+        JSONWriteDigits64(pOut + digits, magnitude);
+        return length + digits;
     }
 }
-/// @brief Removes an element from an array node at a specified index
-/// @param pArrayNode The array node.
-/// @param idx The index.
-void JSONArrayNodeRemoveNode(JSONNode_t* pArrayNode, int_type idx) {
-    JsonAssert(pArrayNode != NULL);
-    JsonAssertMsg(pArrayNode->type == JSONArrayType, "Tried to remove an array element from a node that wasn't an array ! (what are you doing :sob:)");
 
-    JSONArray_t* pArray = pArrayNode->value.pArray;
+// Shortest round-trip float/double formatting, based on Florian Loitsch's Grisu2 algorithm
+// ("Printing Floating-Point Numbers Quickly and Accurately with Integers", 2010) the way Milo Yip's dtoa does it.
+// The output always parses back to the exact same value, and is the shortest such output in the overwhelming majority of cases.
 
-    JSONArrayMustBeValid(pArray);
+/// @brief A floating point number with a 64-bit significand: f * 2^e
+typedef struct JSONDiyFp {
+    uint64_t f;
+    int e;
+} JSONDiyFp_t;
+
+// Normalized 10^k for k = -348, -340, ..., 340, so that 10^k ~= f * 2^e
+static const uint64_t jsonCachedPowersF[87] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+static const int16_t jsonCachedPowersE[87] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
 
-    JSONNode_t* pNodeToDelete = NULL;
-    
-    if (idx == ARRAY_POS_END) {
-        pNodeToDelete = pArray->pEnd;
-    } else {
-        pNodeToDelete = JSONArrayGetNthNode(pArray, idx);
-    }
-    JsonAssertMsg(pNodeToDelete != NULL, "Tried to delete node from empty array.");
 
-    if (pNodeToDelete == pArray->pStart) {
-        pArray->pStart = pArray->pStart->pNextSibling;
+static JSONDiyFp_t JSONDiyFpMultiply(JSONDiyFp_t a, JSONDiyFp_t b) {
+    // upper 64 bits of the 128-bit product, rounded
+    const uint64_t M32 = 0xFFFFFFFFULL;
+    uint64_t aHi = a.f >> 32, aLo = a.f & M32, bHi = b.f >> 32, bLo = b.f & M32;
+    uint64_t hiHi = aHi * bHi, loHi = aLo * bHi, hiLo = aHi * bLo, loLo = aLo * bLo;
+    uint64_t tmp = (loLo >> 32) + (hiLo & M32) + (loHi & M32);
+    tmp += 1ULL << 31;
+    JSONDiyFp_t result = {hiHi + (hiLo >> 32) + (loHi >> 32) + (tmp >> 32), a.e + b.e + 64};
+    return result;
+}
+static JSONDiyFp_t JSONDiyFpNormalize(JSONDiyFp_t v) {
+    while ((v.f & (1ULL << 63)) == 0) {
+        v.f <<= 1;
+        v.e--;
     }
-    if (pNodeToDelete == pArray->pEnd) {
-        pArray->pEnd = pArray->pEnd->pPrevSibling;
+    return v;
+}
+/// @brief Computes the normalized value and the boundaries halfway to its neighbors, all sharing the same exponent.
+/// @param significand The significand, including the hidden bit for normal numbers
+/// @param exponent The binary exponent
+/// @param hiddenBit The hidden bit of the source type (2^52 for double, 2^23 for float)
+static void JSONDiyFpBoundaries(uint64_t significand, int exponent, uint64_t hiddenBit, JSONDiyFp_t* pV, JSONDiyFp_t* pMinus, JSONDiyFp_t* pPlus) {
+    JSONDiyFp_t plus = {(significand << 1) + 1, exponent - 1};
+    plus = JSONDiyFpNormalize(plus);
+
+    // the gap below a power of two is half the size of the gap above it
+    JSONDiyFp_t minus;
+    if (significand == hiddenBit) {
+        minus.f = (significand << 2) - 1;
+        minus.e = exponent - 2;
+    } else {
+        minus.f = (significand << 1) - 1;
+        minus.e = exponent - 1;
     }
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
 
-    JSONNodeConnectNeighbors(pNodeToDelete);
-    JSONNodeDestroy(pNodeToDelete);
+    JSONDiyFp_t v = {significand, exponent};
+    *pV = JSONDiyFpNormalize(v);
+    *pMinus = minus;
+    *pPlus = plus;
 }
-void JSONArrayNodeRemoveAllNodes(JSONNode_t* pNode) {
-    JsonAssert(pNode != NULL);
-    JsonAssertMsg(pNode->type == JSONArrayType, "Tried to remove elements from a node that wasn't an array ! (what are you doing :sob:)");
+static JSONDiyFp_t JSONGetCachedPower(int e, int* pK) {
+    // ceil((-61 - e) * log10(2)) picks a power that brings the product's exponent into [-60, -32]
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if (dk - k > 0.0) k++;
 
-    JSONArrayDestroyElements(pNode->value.pArray);
+    unsigned index = (unsigned)((k >> 3) + 1);
+    *pK = -(-348 + (int)(index * 8));
+    JSONDiyFp_t power = {jsonCachedPowersF[index], jsonCachedPowersE[index]};
+    return power;
+}
+static void JSONGrisuRound(char* pDigits, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance) {
+    while (rest < distance && delta - rest >= tenKappa && (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+        pDigits[length - 1]--;
+        rest += tenKappa;
+    }
 }
+static void JSONGrisuDigitGen(JSONDiyFp_t w, JSONDiyFp_t mp, uint64_t delta, char* pDigits, int* pLength, int* pK) {
+    const JSONDiyFp_t one = {1ULL << -mp.e, mp.e};
+    const uint64_t distance = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = (int)JSONCountDigits(p1);
+    *pLength = 0;
 
-void JSONNodeAdoptChildNode(JSONNode_t* pParent, JSONNode_t* pChild) {
-    JsonAssert(pParent != NULL);
-    JsonAssert(pChild != NULL);
-    JsonAssertMsg(pChild->pParent == NULL, "Tried to adopt a child node, but the child node already has a parent ! Nodes should only have one reference at all times.");
-    JsonAssertMsg(JSONNodeCanHaveChildren(pParent), "Tried to add a child node to a node that can't have children !");
+    while (kappa > 0) {
+        uint32_t divisor = (uint32_t)jsonPowersOf10[kappa - 1];
+        uint32_t d = p1 / divisor;
+        p1 %= divisor;
+        if (d != 0 || *pLength != 0) {
+            pDigits[(*pLength)++] = (char)('0' + d);
+        }
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *pK += kappa;
+            JSONGrisuRound(pDigits, *pLength, delta, rest, jsonPowersOf10[kappa] << -one.e, distance);
+            return;
+        }
+    }
 
-    pChild->pParent = pParent;
-    
-    JSONObj_t* pChildren = pParent->value.pChildren;
-    JSONObjMustBeValid(pChildren);
-    
-    if (JSONObjIsEmpty(pChildren)) {
-        pChildren->pFirstChild = pChild;
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d != 0 || *pLength != 0) {
+            pDigits[(*pLength)++] = (char)('0' + d);
+        }
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *pK += kappa;
+            int index = -kappa;
+            JSONGrisuRound(pDigits, *pLength, delta, p2, one.f, distance * (index < 20 ? jsonPowersOf10[index] : 0));
+            return;
+        }
+    }
+}
+/// @brief Generates the shortest digits d such that d * 10^k rounds back to v.
+static void JSONGrisu2(JSONDiyFp_t v, JSONDiyFp_t minus, JSONDiyFp_t plus, char* pDigits, int* pLength, int* pK) {
+    JSONDiyFp_t cachedPower = JSONGetCachedPower(plus.e, pK);
+    JSONDiyFp_t w = JSONDiyFpMultiply(v, cachedPower);
+    JSONDiyFp_t wPlus = JSONDiyFpMultiply(plus, cachedPower);
+    JSONDiyFp_t wMinus = JSONDiyFpMultiply(minus, cachedPower);
+    wMinus.f++;
+    wPlus.f--;
+    JSONGrisuDigitGen(w, wPlus, wPlus.f - wMinus.f, pDigits, pLength, pK);
+}
+static size_t JSONWriteExponent(char* pOut, int exponent) {
+    size_t length = 0;
+    if (exponent < 0) {
+        pOut[length++] = '-';
+        exponent = -exponent;
+    }
+    if (exponent >= 100) {
+        pOut[length++] = (char)('0' + exponent / 100);
+        exponent %= 100;
+        pOut[length++] = jsonDigitPairs[exponent * 2];
+        pOut[length++] = jsonDigitPairs[exponent * 2 + 1];
+    } else if (exponent >= 10) {
+        pOut[length++] = jsonDigitPairs[exponent * 2];
+        pOut[length++] = jsonDigitPairs[exponent * 2 + 1];
     } else {
-        JSONNodeInsertAfter(pChildren->pLastChild, pChild);
+        pOut[length++] = (char)('0' + exponent);
     }
-    pChildren->pLastChild = pChild;
+    return length;
 }
-JSONNode_t* JSONCreateNode(const char* name, JSONType_t type, JSONValue_t value) {
-    JSONNode_t* pNode = (JSONNode_t*)jsonFuncs.malloc(sizeof(JSONNode_t));
+/// @brief Lays out digits * 10^k as a JSON number: plain decimal notation when it's reasonably short, scientific notation otherwise.
+/// Numbers always keep a '.' or an exponent, so they read back as floats.
+static size_t JSONPrettify(char* pOut, int length, int k) {
+    const int kk = length + k; // 10^(kk-1) <= v < 10^kk
+
+    if (0 <= k && kk <= 21) {
+        // 1234e7 -> 12340000000.0
+        for (int i = length; i < kk; i++) {
+            pOut[i] = '0';
+        }
+        pOut[kk] = '.';
+        pOut[kk + 1] = '0';
+        return (size_t)(kk + 2);
+    } else if (0 < kk && kk <= 21) {
+        // 1234e-2 -> 12.34
+        for (int i = length; i > kk; i--) {
+            pOut[i] = pOut[i - 1];
+        }
+        pOut[kk] = '.';
+        return (size_t)(length + 1);
+    } else if (-6 < kk && kk <= 0) {
+        // 1234e-6 -> 0.001234
+        const int offset = 2 - kk;
+        for (int i = length - 1; i >= 0; i--) {
+            pOut[i + offset] = pOut[i];
+        }
+        pOut[0] = '0';
+        pOut[1] = '.';
+        for (int i = 2; i < offset; i++) {
+            pOut[i] = '0';
+        }
+        return (size_t)(length + offset);
+    } else if (length == 1) {
+        // 1e30
+        pOut[1] = 'e';
+        return 2 + JSONWriteExponent(pOut + 2, kk - 1);
+    } else {
+        // 1234e30 -> 1.234e33
+        for (int i = length; i > 1; i--) {
+            pOut[i] = pOut[i - 1];
+        }
+        pOut[1] = '.';
+        pOut[length + 1] = 'e';
+        return (size_t)(length + 2) + JSONWriteExponent(pOut + length + 2, kk - 1);
+    }
+}
+/// @brief Copies a short null-terminated literal, without the terminator. The formatters don't go through a context, so they can't use its memcpy.
+static size_t JSONCopyLiteral(char* pOut, const char* literal) {
+    size_t length = 0;
+    while (literal[length] != '\0') {
+        pOut[length] = literal[length];
+        length++;
+    }
+    return length;
+}
+/// @brief Writes inf/nan according to JSON_NONFINITE_POLICY, since JSON itself can't represent them.
+static size_t JSONFormatNonFinite(char* pOut, bool isNan, bool isNegative) {
+#if JSON_NONFINITE_POLICY == JSON_NONFINITE_STRING
+    return JSONCopyLiteral(pOut, isNan ? "\"NaN\"" : (isNegative ? "\"-Infinity\"" : "\"Infinity\""));
+#else
+    (void)isNan;
+    (void)isNegative;
+#if JSON_NONFINITE_POLICY == JSON_NONFINITE_ASSERT
+    JsonAssertMsg(false, "Tried to dump a non-finite float ! JSON has no way to represent inf or nan.");
+#endif
+    return JSONCopyLiteral(pOut, "null");
+#endif
+}
+/// @brief Formats a double as the shortest string that reads back as the same double. Doesn't depend on jsonFuncs.snprintf (or on the locale).
+/// Non-finite values are written according to JSON_NONFINITE_POLICY.
+/// @param pOut Where to write the characters. Must have room for at least JSON_NUMBER_MAX_CHARS characters. Not null-terminated.
+/// @param value The value
+/// @return The number of characters written
+size_t JSONFormatDouble(char* pOut, double value) {
+    union { double d; uint64_t u; } bits;
+    bits.d = value;
+    bool isNegative = (bits.u >> 63) != 0;
+    int biasedExponent = (int)((bits.u >> 52) & 0x7FF);
+    uint64_t fraction = bits.u & 0x000FFFFFFFFFFFFFULL;
+
+    if (biasedExponent == 0x7FF) {
+        return JSONFormatNonFinite(pOut, fraction != 0, isNegative);
+    }
+
+    size_t length = 0;
+    if (isNegative) {
+        pOut[length++] = '-';
+    }
+    if (biasedExponent == 0 && fraction == 0) {
+        return length + JSONCopyLiteral(pOut + length, "0.0");
+    }
+
+    const uint64_t hiddenBit = 1ULL << 52;
+    uint64_t significand = biasedExponent != 0 ? fraction + hiddenBit : fraction;
+    int exponent = biasedExponent != 0 ? biasedExponent - 1075 : -1074;
+
+    JSONDiyFp_t v, minus, plus;
+    JSONDiyFpBoundaries(significand, exponent, hiddenBit, &v, &minus, &plus);
+
+    int digitCount, k;
+    JSONGrisu2(v, minus, plus, pOut + length, &digitCount, &k);
+    return length + JSONPrettify(pOut + length, digitCount, k);
+}
+/// @brief Formats a float as the shortest string that reads back as the same float. Same rules as JSONFormatDouble.
+/// @param pOut Where to write the characters. Must have room for at least JSON_NUMBER_MAX_CHARS characters. Not null-terminated.
+/// @param value The value
+/// @return The number of characters written
+size_t JSONFormatFloat(char* pOut, float value) {
+    union { float f; uint32_t u; } bits;
+    bits.f = value;
+    bool isNegative = (bits.u >> 31) != 0;
+    int biasedExponent = (int)((bits.u >> 23) & 0xFF);
+    uint32_t fraction = bits.u & 0x007FFFFFU;
+
+    if (biasedExponent == 0xFF) {
+        return JSONFormatNonFinite(pOut, fraction != 0, isNegative);
+    }
+
+    size_t length = 0;
+    if (isNegative) {
+        pOut[length++] = '-';
+    }
+    if (biasedExponent == 0 && fraction == 0) {
+        return length + JSONCopyLiteral(pOut + length, "0.0");
+    }
+
+    const uint64_t hiddenBit = 1ULL << 23;
+    uint64_t significand = biasedExponent != 0 ? fraction + hiddenBit : fraction;
+    int exponent = biasedExponent != 0 ? biasedExponent - 150 : -149;
+
+    JSONDiyFp_t v, minus, plus;
+    JSONDiyFpBoundaries(significand, exponent, hiddenBit, &v, &minus, &plus);
+
+    int digitCount, k;
+    JSONGrisu2(v, minus, plus, pOut + length, &digitCount, &k);
+    return length + JSONPrettify(pOut + length, digitCount, k);
+}
+/// @brief Formats a float_type, picking JSONFormatFloat or JSONFormatDouble depending on what float_type is configured as.
+static size_t JSONFormatFloatType(char* pOut, float_type value) {
+    if (sizeof(float_type) == sizeof(float)) {
+        return JSONFormatFloat(pOut, (float)value);
+    }
+    return JSONFormatDouble(pOut, (double)value);
+}
+#pragma endregion
+
+#pragma region STRING_ESCAPING
+// Quotes, backslashes and control characters have to be escaped inside JSON strings. Everything else (including UTF-8) is copied as is.
+// Strings are scanned many bytes at a time for the first character that needs escaping, and the clean runs in between get copied in bulk,
+// so strings without anything to escape (the vast majority) cost about as much as a memcpy.
+
+// What goes after the backslash for each control character. 'u' means \u00XX.
+static const char jsonControlEscapes[0x20] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u'
+};
+
+static bool JSONCharNeedsEscape(unsigned char c) {
+    return c < 0x20 || c == STRING_DELIM || c == '\\';
+}
+
+#if defined(JSON_ESCAPE_AVX2) || defined(JSON_ESCAPE_SSE2)
+static unsigned int JSONCountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned int)index;
+#else
+    return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+/// @brief Finds the first character of a string that needs escaping.
+/// @param str The string
+/// @param length Its length
+/// @return The index of that character, or length if there isn't any
+static size_t JSONFindEscape(const char* str, size_t length) {
+    size_t i = 0;
+#if defined(JSON_ESCAPE_AVX2)
+    const __m256i quote = _mm256_set1_epi8(STRING_DELIM);
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i lastControl = _mm256_set1_epi8(0x1F);
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(str + i));
+        // min(c, 0x1F) == c exactly when c <= 0x1F (unsigned)
+        __m256i needsEscape = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, lastControl), chunk));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(needsEscape);
+        if (mask != 0) {
+            return i + JSONCountTrailingZeros(mask);
+        }
+    }
+#endif
+#if defined(JSON_ESCAPE_AVX2) || defined(JSON_ESCAPE_SSE2)
+    const __m128i quote16 = _mm_set1_epi8(STRING_DELIM);
+    const __m128i backslash16 = _mm_set1_epi8('\\');
+    const __m128i lastControl16 = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i needsEscape = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote16), _mm_cmpeq_epi8(chunk, backslash16)),
+            _mm_cmpeq_epi8(_mm_min_epu8(chunk, lastControl16), chunk));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(needsEscape);
+        if (mask != 0) {
+            return i + JSONCountTrailingZeros(mask);
+        }
+    }
+#else
+    // SWAR: look at 8 bytes at once using the usual "has a byte less than n" bit tricks. They can flag a few bytes too many
+    // after a real hit, so the 8 bytes get rescanned one by one to find the exact position.
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highBits = 0x8080808080808080ULL;
+    for (; i + 8 <= length; i += 8) {
+        const unsigned char* pChunk = (const unsigned char*)(str + i);
+        uint64_t chunk = 0;
+        for (int b = 0; b < 8; b++) {
+            chunk |= (uint64_t)pChunk[b] << (8 * b);
+        }
+        uint64_t quotes = chunk ^ (ones * STRING_DELIM);
+        uint64_t backslashes = chunk ^ (ones * '\\');
+        uint64_t flagged = ((chunk - ones * 0x20) & ~chunk)
+                         | ((quotes - ones) & ~quotes)
+                         | ((backslashes - ones) & ~backslashes);
+        if ((flagged & highBits) != 0) break;
+    }
+#endif
+    for (; i < length; i++) {
+        if (JSONCharNeedsEscape((unsigned char)str[i])) return i;
+    }
+    return length;
+}
+
+/// @brief Writes the escape sequence of a single character.
+/// @param pOut Where to write it (at least 6 bytes)
+/// @param c The character, which must need escaping
+/// @return How many bytes were written
+static size_t JSONFormatEscape(char* pOut, unsigned char c) {
+    static const char hexDigits[] = "0123456789abcdef";
+    pOut[0] = '\\';
+    if (c >= 0x20) { // " or \ themselves
+        pOut[1] = (char)c;
+        return 2;
+    }
+    pOut[1] = jsonControlEscapes[c];
+    if (pOut[1] != 'u') return 2;
+    pOut[2] = '0';
+    pOut[3] = '0';
+    pOut[4] = hexDigits[c >> 4];
+    pOut[5] = hexDigits[c & 0xF];
+    return 6;
+}
+
+/// @brief Gets the length a string will have once escaped (not counting the quotes around it).
+/// @param str The string
+/// @param length Its length before escaping
+/// @return Its length after escaping
+size_t JSONGetEscapedLength(const char* str, size_t length) {
+    size_t escapedLength = length;
+    size_t i = JSONFindEscape(str, length);
+    while (i < length) {
+        unsigned char c = (unsigned char)str[i];
+        escapedLength = JSONAddLengths(escapedLength, (c >= 0x20 || jsonControlEscapes[c] != 'u') ? 1 : 5);
+        i++;
+        i += JSONFindEscape(str + i, length - i);
+    }
+    return escapedLength;
+}
+#pragma endregion
+
+#pragma region VALIDATION
+// The scanners below return the index right after the token starting at i, or i itself if there isn't a valid one there.
+
+static bool JSONIsWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+static bool JSONIsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+static bool JSONIsHexDigit(char c) {
+    return JSONIsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+static size_t JSONSkipWhitespace(const char* json, size_t length, size_t i) {
+    while (i < length && JSONIsWhitespace(json[i])) {
+        i++;
+    }
+    return i;
+}
+static size_t JSONScanString(const char* json, size_t length, size_t i) {
+    if (i >= length || json[i] != STRING_DELIM) return i;
+
+    for (size_t j = i + 1; j < length; j++) {
+        unsigned char c = (unsigned char)json[j];
+        if (c == STRING_DELIM) return j + 1;
+        if (c < 0x20) return i;
+        if (c != '\\') continue;
+
+        j++;
+        if (j >= length) return i;
+        switch (json[j]) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't': {
+                break;
+            }
+            case 'u': {
+                if (length - j <= 4) return i;
+                for (size_t k = 1; k <= 4; k++) {
+                    if (!JSONIsHexDigit(json[j + k])) return i;
+                }
+                j += 4;
+                break;
+            }
+            default: {
+                return i;
+            }
+        }
+    }
+    return i; // never closed
+}
+static size_t JSONScanDigits(const char* json, size_t length, size_t i) {
+    while (i < length && JSONIsDigit(json[i])) {
+        i++;
+    }
+    return i;
+}
+static size_t JSONScanNumber(const char* json, size_t length, size_t i) {
+    size_t j = i;
+    if (j < length && json[j] == '-') j++;
+
+    // no leading zeros
+    if (j < length && json[j] == '0') {
+        j++;
+    } else {
+        size_t end = JSONScanDigits(json, length, j);
+        if (end == j) return i;
+        j = end;
+    }
+    if (j < length && json[j] == '.') {
+        size_t end = JSONScanDigits(json, length, j + 1);
+        if (end == j + 1) return i;
+        j = end;
+    }
+    if (j < length && (json[j] == 'e' || json[j] == 'E')) {
+        j++;
+        if (j < length && (json[j] == '+' || json[j] == '-')) j++;
+        size_t end = JSONScanDigits(json, length, j);
+        if (end == j) return i;
+        j = end;
+    }
+    return j;
+}
+static size_t JSONScanLiteral(const char* json, size_t length, size_t i, const char* literal, size_t literalLength) {
+    if (length - i < literalLength) return i;
+    for (size_t k = 0; k < literalLength; k++) {
+        if (json[i + k] != literal[k]) return i;
+    }
+    return i + literalLength;
+}
+/// @brief Scans a key, the ':' after it, and the whitespace around them.
+static size_t JSONScanKey(const char* json, size_t length, size_t i) {
+    size_t end = JSONScanString(json, length, i);
+    if (end == i) return i;
+    end = JSONSkipWhitespace(json, length, end);
+    if (end >= length || json[end] != KEYVAL_SEPARATOR) return i;
+    return JSONSkipWhitespace(json, length, end + 1);
+}
+/// @brief Scans a value that isn't an object or array.
+static size_t JSONScanScalar(const char* json, size_t length, size_t i) {
+    switch (json[i]) {
+        case STRING_DELIM: return JSONScanString(json, length, i);
+        case 't': return JSONScanLiteral(json, length, i, "true", 4);
+        case 'f': return JSONScanLiteral(json, length, i, "false", 5);
+        case 'n': return JSONScanLiteral(json, length, i, "null", 4);
+        default: return JSONScanNumber(json, length, i);
+    }
+}
+
+/// @brief Checks that some bytes are exactly one valid JSON value (whitespace around it is fine), nested at most JSON_MAX_DEPTH deep.
+/// Doesn't recurse or allocate: the only state it keeps is one bit per open object/array.
+/// Doesn't check that strings are valid UTF-8, only that they're valid JSON strings.
+/// @param json The bytes
+/// @param length How many there are
+/// @return Whether it's valid JSON
+bool JSONValidate(const char* json, size_t length) {
+    JsonAssert(json != NULL || length == 0);
+    uint8_t objBits[(JSON_MAX_DEPTH + 7) / 8 + 1]; // bit n is set if the container at depth n is an object
+    size_t depth = 0;
+    size_t i = JSONSkipWhitespace(json, length, 0);
+    for (;;) {
+        // a value starts at i
+        if (i >= length) return false;
+        char c = json[i];
+        if (c == JSONOBJ_START || c == JSONARRAY_START) {
+            if (depth >= JSON_MAX_DEPTH) return false;
+            bool bObj = c == JSONOBJ_START;
+            if (bObj) {
+                objBits[depth / 8] |= (uint8_t)(1u << (depth % 8));
+            } else {
+                objBits[depth / 8] &= (uint8_t)~(1u << (depth % 8));
+            }
+            depth++;
+            i = JSONSkipWhitespace(json, length, i + 1);
+            if (i < length && json[i] == (bObj ? JSONOBJ_END : JSONARRAY_END)) {
+                depth--;
+                i++;
+            } else {
+                if (bObj) {
+                    size_t end = JSONScanKey(json, length, i);
+                    if (end == i) return false;
+                    i = end;
+                }
+                continue;
+            }
+        } else {
+            size_t end = JSONScanScalar(json, length, i);
+            if (end == i) return false;
+            i = end;
+        }
+
+        // the value is done: go on to the next one, closing whatever containers end here
+        for (;;) {
+            i = JSONSkipWhitespace(json, length, i);
+            if (depth == 0) return i == length;
+            if (i >= length) return false;
+
+            bool bObj = (objBits[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1;
+            if (json[i] == (bObj ? JSONOBJ_END : JSONARRAY_END)) {
+                depth--;
+                i++;
+                continue;
+            }
+            if (json[i] != CHILD_SEPARATOR) return false;
+            i = JSONSkipWhitespace(json, length, i + 1);
+            if (bObj) {
+                size_t end = JSONScanKey(json, length, i);
+                if (end == i) return false;
+                i = end;
+            }
+            break;
+        }
+    }
+}
+/// @brief Asserts that raw JSON is valid, if JSON_VALIDATE_RAW is on.
+static void JSONRawMustBeValid(const char* json, size_t length) {
+    JsonAssert(json != NULL || length == 0);
+#if JSON_VALIDATE_RAW
+    JsonAssertMsg(JSONValidate(json, length), "Raw JSON isn't valid JSON !");
+#else
+    (void)json;
+    (void)length;
+#endif
+}
+#pragma endregion
+
+#pragma region KEY_INTERNING
+// Below this many buckets per key, the key table doubles
+#define JSON_KEY_TABLE_MIN_BUCKETS 64
+// An interned key is a single allocation: the entry, then its copy of the name, then its "key": fragment
+#define JSON_KEY_BYTES(nameLength, fragmentLength) (sizeof(JSONKey_t) + (nameLength) + 1 + (fragmentLength))
+
+/// @brief FNV-1a, measuring the key on the way so it only gets read once.
+static uint32_t JSONHashKey(const char* name, size_t* pOutLength) {
+    uint32_t hash = 2166136261u;
+    size_t length = 0;
+    while (name[length] != '\0') {
+        hash = (hash ^ (unsigned char)name[length]) * 16777619u;
+        length++;
+    }
+    *pOutLength = length;
+    return hash;
+}
+static void JSONKeyTableGrow(JSONContext_t* pCtx) {
+    JSONKeyTable_t* pTable = &pCtx->keys;
+    size_t newBucketCount = pTable->bucketCount > 0 ? pTable->bucketCount * 2 : JSON_KEY_TABLE_MIN_BUCKETS;
+    JSONKey_t** ppNewBuckets = (JSONKey_t**)JSONCtxAlloc(pCtx, newBucketCount * sizeof(JSONKey_t*));
+    JsonAssert(ppNewBuckets != NULL);
+    (void)pCtx->funcs.memset(ppNewBuckets, 0, newBucketCount * sizeof(JSONKey_t*));
+
+    for (size_t i = 0; i < pTable->bucketCount; i++) {
+        JSONKey_t* pKey = pTable->ppBuckets[i];
+        while (pKey != NULL) {
+            JSONKey_t* pNext = pKey->pNext;
+            size_t bucket = pKey->hash & (newBucketCount - 1);
+            pKey->pNext = ppNewBuckets[bucket];
+            ppNewBuckets[bucket] = pKey;
+            pKey = pNext;
+        }
+    }
+    if (pTable->ppBuckets != NULL) {
+        JSONCtxRelease(pCtx, pTable->ppBuckets, pTable->bucketCount * sizeof(JSONKey_t*));
+    }
+    pTable->ppBuckets = ppNewBuckets;
+    pTable->bucketCount = newBucketCount;
+}
+static void JSONKeyTableDestroy(JSONContext_t* pCtx) {
+    JSONKeyTable_t* pTable = &pCtx->keys;
+    for (size_t i = 0; i < pTable->bucketCount; i++) {
+        JSONKey_t* pKey = pTable->ppBuckets[i];
+        while (pKey != NULL) {
+            JSONKey_t* pNext = pKey->pNext;
+            JSONCtxRelease(pCtx, pKey, JSON_KEY_BYTES(pKey->nameLength, pKey->fragmentLength));
+            pKey = pNext;
+        }
+    }
+    if (pTable->ppBuckets != NULL) {
+        JSONCtxRelease(pCtx, pTable->ppBuckets, pTable->bucketCount * sizeof(JSONKey_t*));
+    }
+    pTable->ppBuckets = NULL;
+    pTable->bucketCount = 0;
+    pTable->keyCount = 0;
+}
+/// @brief Interns a key, unless it isn't interned yet and the context already holds maxKeys keys (0 for no limit).
+/// @return The interned key, NULL if there was no room for it
+static const JSONKey_t* JSONCtxInternKeyUpTo(JSONContext_t* pCtx, const char* name, size_t maxKeys) {
+    size_t nameLength;
+    uint32_t hash = JSONHashKey(name, &nameLength);
+
+    JSONKeyTable_t* pTable = &pCtx->keys;
+    if (pTable->bucketCount > 0) {
+        for (JSONKey_t* pKey = pTable->ppBuckets[hash & (pTable->bucketCount - 1)]; pKey != NULL; pKey = pKey->pNext) {
+            if (pKey->hash == hash && pKey->nameLength == nameLength && (nameLength == 0 || pKey->name[0] == name[0])) {
+                size_t i = 0;
+                while (i < nameLength && pKey->name[i] == name[i]) i++;
+                if (i == nameLength) return pKey;
+            }
+        }
+    }
+    if (maxKeys != 0 && pTable->keyCount >= maxKeys) return NULL;
+
+    if (pTable->keyCount >= pTable->bucketCount - pTable->bucketCount / 4) { // keep the load factor under 3/4
+        JSONKeyTableGrow(pCtx);
+    }
+
+    // one allocation: the entry, then the name, then the fragment
+    size_t fragmentLength = sizeof(STRING_DELIM) + JSONGetEscapedLength(name, nameLength) + sizeof(STRING_DELIM) + sizeof(KEYVAL_SEPARATOR);
+    JSONKey_t* pKey = (JSONKey_t*)JSONCtxAlloc(pCtx, JSON_KEY_BYTES(nameLength, fragmentLength));
+    JsonAssert(pKey != NULL);
+    char* pName = (char*)(pKey + 1);
+    char* pFragment = pName + nameLength + 1;
+    (void)pCtx->funcs.memcpy(pName, name, nameLength + 1);
+
+    char* pOut = pFragment;
+    *pOut++ = STRING_DELIM;
+    size_t i = 0;
+    while (i < nameLength) {
+        size_t runLength = JSONFindEscape(name + i, nameLength - i);
+        (void)pCtx->funcs.memcpy(pOut, name + i, runLength);
+        pOut += runLength;
+        i += runLength;
+        if (i == nameLength) break;
+        pOut += JSONFormatEscape(pOut, (unsigned char)name[i]);
+        i++;
+    }
+    *pOut++ = STRING_DELIM;
+    *pOut++ = KEYVAL_SEPARATOR;
+    JsonAssert((size_t)(pOut - pFragment) == fragmentLength);
+
+    pKey->name = pName;
+    pKey->nameLength = nameLength;
+    pKey->pFragment = pFragment;
+    pKey->fragmentLength = fragmentLength;
+    pKey->hash = hash;
+    size_t bucket = hash & (pTable->bucketCount - 1);
+    pKey->pNext = pTable->ppBuckets[bucket];
+    pTable->ppBuckets[bucket] = pKey;
+    pTable->keyCount++;
+    return pKey;
+}
+/// @brief Interns a key: the first time a key is seen it gets copied, escaped and rendered as "key": once, and every later call returns that same entry.
+/// Interned keys live as long as the context. Explicit calls always intern, JSON_MAX_INTERNED_KEYS only limits the nodes' automatic interning.
+/// @param pCtx The context
+/// @param name The key
+/// @return The interned key
+const JSONKey_t* JSONCtxInternKey(JSONContext_t* pCtx, const char* name) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(name != NULL);
+    return JSONCtxInternKeyUpTo(pCtx, name, 0);
+}
+/// @brief Turns key interning on or off for the nodes adopted into objects from now on. Already interned keys stay valid.
+/// Worth turning off for trees whose keys are all different (e.g. maps keyed by ids) and that get dumped once.
+void JSONCtxSetKeyInterning(JSONContext_t* pCtx, bool bEnable) {
+    JsonAssert(pCtx != NULL);
+    pCtx->bInternKeys = bEnable;
+}
+/// @brief Points a node to the interned version of its name if it's in an object and its context interns keys.
+/// Past JSON_MAX_INTERNED_KEYS, only keys that are interned already get used, so contexts that live forever don't keep every key they've ever seen.
+static void JSONNodeUpdateKey(JSONNode_t* pNode) {
+    JSONContext_t* pCtx = pNode->pCtx;
+    if (pCtx->bInternKeys && pNode->pParent != NULL && pNode->pParent->type == JSONObjType) {
+        pNode->pKey = JSONCtxInternKeyUpTo(pCtx, pNode->name, JSON_MAX_INTERNED_KEYS);
+    } else {
+        pNode->pKey = NULL;
+    }
+}
+#pragma endregion
+
+#pragma region ARRAY_INDEX
+// An array index is a vector of pointers to the elements, in order, with free slots on both sides of them.
+// Getting the nth element is O(1), adding/removing at either end is amortized O(1), and inserting/removing in the middle
+// moves whichever side of the index is shorter, which is just pointers in one contiguous block (no list walking).
+struct JSONArrayIndex {
+    size_t head; // slot of the first element
+    size_t capacity;
+    JSONNode_t* slots[];
+};
+#define JSON_ARRAY_INDEX_BYTES(capacity) (sizeof(struct JSONArrayIndex) + (capacity) * sizeof(JSONNode_t*))
+// Smallest number of slots an index gets
+#define JSON_ARRAY_INDEX_MIN_CAPACITY 16
+// Returned when the position of a node in its array isn't known
+#define JSON_INDEX_UNKNOWN ((size_t)-1)
+
+/// @brief Moves count pointers, correctly even if the source and destination overlap (the function table has no memmove).
+static void JSONMovePointers(JSONNode_t** ppDest, JSONNode_t** ppSrc, size_t count) {
+    if (ppDest < ppSrc) {
+        for (size_t i = 0; i < count; i++) {
+            ppDest[i] = ppSrc[i];
+        }
+    } else if (ppDest > ppSrc) {
+        for (size_t i = count; i > 0; i--) {
+            ppDest[i - 1] = ppSrc[i - 1];
+        }
+    }
+}
+static void JSONArrayIndexFree(JSONArray_t* pArray, JSONContext_t* pCtx) {
+    if (pArray->pIndex != NULL) {
+        JSONCtxRelease(pCtx, pArray->pIndex, JSON_ARRAY_INDEX_BYTES(pArray->pIndex->capacity));
+        pArray->pIndex = NULL;
+    }
+}
+/// @brief Lays the index out again with room for at least one more element on both sides, growing it if it's more than half full.
+static void JSONArrayIndexRecenter(JSONArray_t* pArray, JSONContext_t* pCtx) {
+    struct JSONArrayIndex* pIndex = pArray->pIndex;
+    size_t count = pArray->count;
+    size_t capacity = pIndex->capacity;
+    if ((count + 1) * 2 > capacity) {
+        capacity = (count + 1) * 2;
+    }
+    size_t head = (capacity - count) / 2;
+
+    if (capacity == pIndex->capacity) {
+        JSONMovePointers(pIndex->slots + head, pIndex->slots + pIndex->head, count);
+    } else {
+        struct JSONArrayIndex* pNewIndex = (struct JSONArrayIndex*)JSONCtxAlloc(pCtx, JSON_ARRAY_INDEX_BYTES(capacity));
+        JsonAssert(pNewIndex != NULL);
+        (void)pCtx->funcs.memcpy(pNewIndex->slots + head, pIndex->slots + pIndex->head, count * sizeof(JSONNode_t*));
+        JSONCtxRelease(pCtx, pIndex, JSON_ARRAY_INDEX_BYTES(pIndex->capacity));
+        pIndex = pNewIndex;
+        pIndex->capacity = capacity;
+        pArray->pIndex = pIndex;
+    }
+    pIndex->head = head;
+}
+/// @brief Builds the index of an array from its list.
+static void JSONArrayIndexBuild(JSONArray_t* pArray, JSONContext_t* pCtx) {
+    size_t capacity = pArray->count * 2;
+    if (capacity < JSON_ARRAY_INDEX_MIN_CAPACITY) {
+        capacity = JSON_ARRAY_INDEX_MIN_CAPACITY;
+    }
+    struct JSONArrayIndex* pIndex = (struct JSONArrayIndex*)JSONCtxAlloc(pCtx, JSON_ARRAY_INDEX_BYTES(capacity));
+    JsonAssert(pIndex != NULL);
+    pIndex->capacity = capacity;
+    pIndex->head = (capacity - pArray->count) / 2;
+
+    JSONNode_t** ppSlot = pIndex->slots + pIndex->head;
+    for (JSONNode_t* current = pArray->pStart; current != NULL; current = current->pNextSibling) {
+        *ppSlot++ = current;
+    }
+    JsonAssertMsg(ppSlot == pIndex->slots + pIndex->head + pArray->count, "Array element count is out of date !");
+    pArray->pIndex = pIndex;
+}
+/// @brief Records in the index that pNode got inserted at position idx. Call before incrementing count.
+static void JSONArrayIndexInsert(JSONArray_t* pArray, JSONContext_t* pCtx, size_t idx, JSONNode_t* pNode) {
+    struct JSONArrayIndex* pIndex = pArray->pIndex;
+    size_t count = pArray->count;
+    bool bShiftFront = idx < count - idx;
+
+    if ((bShiftFront && pIndex->head == 0) || (!bShiftFront && pIndex->head + count == pIndex->capacity)) {
+        JSONArrayIndexRecenter(pArray, pCtx);
+        pIndex = pArray->pIndex;
+    }
+
+    JSONNode_t** ppFirst = pIndex->slots + pIndex->head;
+    if (bShiftFront) {
+        JSONMovePointers(ppFirst - 1, ppFirst, idx);
+        pIndex->head--;
+    } else {
+        JSONMovePointers(ppFirst + idx + 1, ppFirst + idx, count - idx);
+    }
+    pIndex->slots[pIndex->head + idx] = pNode;
+}
+/// @brief Records in the index that the element at position idx got removed. Call before decrementing count.
+static void JSONArrayIndexRemove(JSONArray_t* pArray, size_t idx) {
+    struct JSONArrayIndex* pIndex = pArray->pIndex;
+    JSONNode_t** ppFirst = pIndex->slots + pIndex->head;
+    if (idx < pArray->count - 1 - idx) {
+        JSONMovePointers(ppFirst + 1, ppFirst, idx);
+        pIndex->head++;
+    } else {
+        JSONMovePointers(ppFirst + idx, ppFirst + idx + 1, pArray->count - 1 - idx);
+    }
+}
+#pragma endregion
+
+#pragma region OBJ_INDEX
+// An object index is an open addressing hash table (linear probing) from keys to children. The list of children stays
+// what decides the order they get dumped in, the index only finds them. Objects can hold the same key more than once:
+// only the first child with a given key is in the index, the later ones are just counted so that removing the first one
+// knows whether it has to look for the next.
+struct JSONObjIndexSlot {
+    JSONNode_t* pNode; // NULL if the slot is free
+    uint32_t hash;
+};
+struct JSONObjIndex {
+    size_t capacity; // always a power of 2
+    size_t used;
+    size_t duplicates; // children left out because an earlier sibling has the same key
+    struct JSONObjIndexSlot slots[];
+};
+#define JSON_OBJ_INDEX_BYTES(capacity) (sizeof(struct JSONObjIndex) + (capacity) * sizeof(struct JSONObjIndexSlot))
+// Smallest number of slots an index gets
+#define JSON_OBJ_INDEX_MIN_CAPACITY 32
+
+static bool JSONNamesEqual(const char* a, const char* b) {
+    if (a == b) return true;
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+/// @brief Hashes the name of a node, which is free if its key is interned.
+static uint32_t JSONNodeHashName(JSONNode_t* pNode) {
+    if (pNode->pKey != NULL) {
+        return pNode->pKey->hash;
+    }
+    size_t length;
+    return JSONHashKey(pNode->name, &length);
+}
+static void JSONObjIndexFree(JSONObj_t* pObj, JSONContext_t* pCtx) {
+    if (pObj->pIndex != NULL) {
+        JSONCtxRelease(pCtx, pObj->pIndex, JSON_OBJ_INDEX_BYTES(pObj->pIndex->capacity));
+        pObj->pIndex = NULL;
+    }
+}
+/// @brief Finds the slot of the child with the given name, or the free slot it would go in.
+static struct JSONObjIndexSlot* JSONObjIndexFind(struct JSONObjIndex* pIndex, const char* name, uint32_t hash) {
+    size_t mask = pIndex->capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        struct JSONObjIndexSlot* pSlot = &pIndex->slots[i];
+        if (pSlot->pNode == NULL || (pSlot->hash == hash && JSONNamesEqual(pSlot->pNode->name, name))) {
+            return pSlot;
+        }
+    }
+}
+static struct JSONObjIndex* JSONObjIndexAlloc(JSONContext_t* pCtx, size_t capacity) {
+    struct JSONObjIndex* pIndex = (struct JSONObjIndex*)JSONCtxAlloc(pCtx, JSON_OBJ_INDEX_BYTES(capacity));
+    JsonAssert(pIndex != NULL);
+    (void)pCtx->funcs.memset(pIndex->slots, 0, capacity * sizeof(struct JSONObjIndexSlot));
+    pIndex->capacity = capacity;
+    pIndex->used = 0;
+    pIndex->duplicates = 0;
+    return pIndex;
+}
+/// @brief Doubles the number of slots of an index.
+static void JSONObjIndexGrow(JSONObj_t* pObj, JSONContext_t* pCtx) {
+    struct JSONObjIndex* pIndex = pObj->pIndex;
+    struct JSONObjIndex* pNewIndex = JSONObjIndexAlloc(pCtx, pIndex->capacity * 2);
+    size_t mask = pNewIndex->capacity - 1;
+    for (size_t i = 0; i < pIndex->capacity; i++) {
+        if (pIndex->slots[i].pNode == NULL) continue;
+        size_t j = pIndex->slots[i].hash & mask;
+        while (pNewIndex->slots[j].pNode != NULL) {
+            j = (j + 1) & mask;
+        }
+        pNewIndex->slots[j] = pIndex->slots[i];
+    }
+    pNewIndex->used = pIndex->used;
+    pNewIndex->duplicates = pIndex->duplicates;
+    JSONCtxRelease(pCtx, pIndex, JSON_OBJ_INDEX_BYTES(pIndex->capacity));
+    pObj->pIndex = pNewIndex;
+}
+/// @brief Records a child in the index. Children have to be added in their order in the list.
+/// @return Whether it got its own slot (false if an earlier child already has its key)
+static bool JSONObjIndexAdd(JSONObj_t* pObj, JSONContext_t* pCtx, JSONNode_t* pNode) {
+    if ((pObj->pIndex->used + 1) * 2 > pObj->pIndex->capacity) { // keep the load factor under 1/2, probe runs stay short
+        JSONObjIndexGrow(pObj, pCtx);
+    }
+    struct JSONObjIndex* pIndex = pObj->pIndex;
+    uint32_t hash = JSONNodeHashName(pNode);
+    struct JSONObjIndexSlot* pSlot = JSONObjIndexFind(pIndex, pNode->name, hash);
+    if (pSlot->pNode != NULL) {
+        pIndex->duplicates++;
+        return false;
+    }
+    pSlot->pNode = pNode;
+    pSlot->hash = hash;
+    pIndex->used++;
+    return true;
+}
+/// @brief Builds the index of an object from its list.
+static void JSONObjIndexBuild(JSONObj_t* pObj, JSONContext_t* pCtx) {
+    size_t capacity = JSON_OBJ_INDEX_MIN_CAPACITY;
+    while (capacity < pObj->count * 2) {
+        capacity *= 2;
+    }
+    pObj->pIndex = JSONObjIndexAlloc(pCtx, capacity);
+    for (JSONNode_t* current = pObj->pFirstChild; current != NULL; current = current->pNextSibling) {
+        (void)JSONObjIndexAdd(pObj, pCtx, current);
+    }
+}
+/// @brief Takes a child out of the index. Call while it's still in the list.
+static void JSONObjIndexRemove(JSONObj_t* pObj, JSONNode_t* pNode) {
+    struct JSONObjIndex* pIndex = pObj->pIndex;
+    struct JSONObjIndexSlot* pSlot = JSONObjIndexFind(pIndex, pNode->name, JSONNodeHashName(pNode));
+    JsonAssertMsg(pSlot->pNode != NULL, "Object index is out of date !");
+    if (pSlot->pNode != pNode) {
+        // one of the duplicates
+        pIndex->duplicates--;
+        return;
+    }
+    if (pIndex->duplicates > 0) {
+        // the next child with the same key (if any) becomes the first one, and takes over the slot
+        for (JSONNode_t* current = pNode->pNextSibling; current != NULL; current = current->pNextSibling) {
+            if (JSONNamesEqual(current->name, pNode->name)) {
+                pSlot->pNode = current;
+                pIndex->duplicates--;
+                return;
+            }
+        }
+    }
+
+    // backward shift deletion: the entries after the hole that would have landed in it move back,
+    // so that a lookup never stops at the hole before reaching them (no tombstones needed)
+    size_t mask = pIndex->capacity - 1;
+    size_t hole = (size_t)(pSlot - pIndex->slots);
+    for (size_t i = (hole + 1) & mask; pIndex->slots[i].pNode != NULL; i = (i + 1) & mask) {
+        size_t home = pIndex->slots[i].hash & mask;
+        if (((i - hole) & mask) <= ((i - home) & mask)) {
+            pIndex->slots[hole] = pIndex->slots[i];
+            hole = i;
+        }
+    }
+    pIndex->slots[hole].pNode = NULL;
+    pIndex->used--;
+}
+#pragma endregion
+
+#pragma region PACKED_ARRAYS
+#define JSON_PACKED_ARRAY_MIN_CAPACITY 8
+
+static size_t JSONPackedArrayGetElementSize(JSONType_t type) {
+    return type == JSONIntArrayType ? sizeof(int_type) : sizeof(float_type);
+}
+/// @brief Gets the length of some packed values once dumped, with the separators between them but without the brackets.
+static size_t JSONPackedArrayGetFormattedLength(JSONType_t type, const void* pValues, size_t count) {
+    if (count == 0) return 0;
+
+    size_t length = count - 1; // separators
+    if (type == JSONIntArrayType) {
+        const int_type* pInts = (const int_type*)pValues;
+        for (size_t i = 0; i < count; i++) {
+            length = JSONAddLengths(length, JSONIntGetFormattedLength(pInts[i]));
+        }
+    } else {
+        const float_type* pFloats = (const float_type*)pValues;
+        char scratch[JSON_NUMBER_MAX_CHARS];
+        for (size_t i = 0; i < count; i++) {
+            length = JSONAddLengths(length, JSONFormatFloatType(scratch, pFloats[i]));
+        }
+    }
+    return length;
+}
+/// @brief Allocates memory for packed values from the context's active arena if there is one, from its malloc otherwise.
+/// @param pbArena Receives whether it came from an arena (and so must not be freed)
+static void* JSONPackedArrayAlloc(JSONContext_t* pCtx, JSONType_t type, size_t capacity, bool* pbArena) {
+    size_t size = JSONMulLengths(capacity, JSONPackedArrayGetElementSize(type));
+    void* pData;
+    if (pCtx->pArena != NULL) {
+        pData = JSONArenaAlloc(pCtx->pArena, size);
+        *pbArena = true;
+    } else {
+        pData = JSONCtxAlloc(pCtx, size);
+        *pbArena = false;
+    }
+    JsonAssert(pData != NULL);
+    return pData;
+}
+/// @brief Frees the values of a packed array node, unless they're borrowed or live in an arena.
+static void JSONPackedArrayFree(JSONNode_t* pNode) {
+    JSONPackedArray_t* pPacked = &pNode->value.packed;
+    if (!pPacked->bBorrowed && !pPacked->bArena && pPacked->pData != NULL) {
+        JSONCtxRelease(pNode->pCtx, pPacked->pData, pPacked->capacity * JSONPackedArrayGetElementSize(pNode->type));
+    }
+    pPacked->pData = NULL;
+    pPacked->capacity = 0;
+}
+/// @brief Makes sure `extra` more values fit in a packed array, doubling its capacity as many times as needed. Borrowed values get copied.
+static void JSONPackedArrayReserve(JSONNode_t* pNode, size_t extra) {
+    JSONPackedArray_t* pPacked = &pNode->value.packed;
+    size_t needed = JSONAddLengths(pPacked->count, extra);
+    if (!pPacked->bBorrowed && needed <= pPacked->capacity) return;
+
+    size_t newCapacity = pPacked->capacity > 0 ? pPacked->capacity : JSON_PACKED_ARRAY_MIN_CAPACITY;
+    while (newCapacity < needed) {
+        if (newCapacity > SIZE_MAX / 2) {
+            newCapacity = needed;
+            break;
+        }
+        newCapacity *= 2;
+    }
+
+    bool bArena;
+    void* pNewData = JSONPackedArrayAlloc(pNode->pCtx, pNode->type, newCapacity, &bArena);
+    if (pPacked->count > 0) {
+        (void)pNode->pCtx->funcs.memcpy(pNewData, pPacked->pData, pPacked->count * JSONPackedArrayGetElementSize(pNode->type));
+    }
+    JSONPackedArrayFree(pNode);
+    pPacked->pData = pNewData;
+    pPacked->capacity = newCapacity;
+    pPacked->bBorrowed = false;
+    pPacked->bArena = bArena;
+}
+/// @brief Appends values to a packed array node. The node's length (and its ancestors') gets updated once for the whole batch.
+static void JSONPackedArrayNodeAppend(JSONNode_t* pNode, JSONType_t type, const void* pValues, size_t count) {
+    JsonAssert(pNode != NULL);
+    JsonAssertMsg(pNode->type == type, "Tried to append values of the wrong type to a packed array !");
+    JsonAssert(pValues != NULL || count == 0);
+    if (count == 0) return;
+
+    JSONPackedArray_t* pPacked = &pNode->value.packed;
+    JSONPackedArrayReserve(pNode, count);
+    size_t elementSize = JSONPackedArrayGetElementSize(type);
+    (void)pNode->pCtx->funcs.memcpy((char*)pPacked->pData + pPacked->count * elementSize, pValues, count * elementSize);
+
+    size_t addedLength = JSONPackedArrayGetFormattedLength(type, pValues, count);
+    if (pPacked->count > 0) {
+        addedLength = JSONAddLengths(addedLength, sizeof(CHILD_SEPARATOR));
+    }
+    pPacked->count += count;
+    JSONNodeValueLengthChanged(pNode, 0, addedLength);
+}
+/// @brief Gets the number of values in a packed int/float array node.
+size_t JSONPackedArrayNodeGetCount(JSONNode_t* pNode) {
     JsonAssert(pNode != NULL);
+    JsonAssert(JSONNodeIsPackedArray(pNode));
+    return pNode->value.packed.count;
+}
+/// @brief Appends ints to a packed int array node. If its values were borrowed, they get copied first.
+/// @param pNode The JSONIntArrayType node
+/// @param pValues The values to append (copied)
+/// @param count How many there are
+void JSONIntArrayNodeAppend(JSONNode_t* pNode, const int_type* pValues, size_t count) {
+    JSONPackedArrayNodeAppend(pNode, JSONIntArrayType, pValues, count);
+}
+/// @brief Appends floats to a packed float array node. If its values were borrowed, they get copied first.
+/// @param pNode The JSONFloatArrayType node
+/// @param pValues The values to append (copied)
+/// @param count How many there are
+void JSONFloatArrayNodeAppend(JSONNode_t* pNode, const float_type* pValues, size_t count) {
+    JSONPackedArrayNodeAppend(pNode, JSONFloatArrayType, pValues, count);
+}
+#pragma endregion
+
+#pragma region STRING_VALUES
+/// @brief Copies a string value into the context's active arena if there is one, into memory from its malloc otherwise. The copy is null-terminated.
+/// @param pbOwned Receives whether the copy has to be freed along with its node (i.e. it didn't come from an arena)
+static const char* JSONCtxCopyString(JSONContext_t* pCtx, const char* str, size_t length, bool* pbOwned) {
+    size_t size = JSONAddLengths(length, 1);
+    char* pCopy;
+    if (pCtx->pArena != NULL) {
+        pCopy = (char*)JSONArenaAlloc(pCtx->pArena, size);
+        *pbOwned = false;
+    } else {
+        pCopy = (char*)JSONCtxAlloc(pCtx, size);
+        *pbOwned = true;
+    }
+    JsonAssert(pCopy != NULL);
+    (void)pCtx->funcs.memcpy(pCopy, str, length);
+    pCopy[length] = '\0';
+    return pCopy;
+}
+/// @brief Makes a string value, copying it first if asked to.
+static JSONValue_t JSONCtxMakeStringValue(JSONContext_t* pCtx, const char* str, size_t length, bool bCopy) {
+    JsonAssert(str != NULL || length == 0);
+    JSONValue_t jsonValue;
+    (void)pCtx->funcs.memset(&jsonValue, 0, sizeof(JSONValue_t));
+    jsonValue.str.length = length;
+    if (bCopy) {
+        jsonValue.str.pData = JSONCtxCopyString(pCtx, str != NULL ? str : "", length, &jsonValue.str.bOwned);
+    } else {
+        jsonValue.str.pData = str;
+    }
+    return jsonValue;
+}
+/// @brief Frees whatever memory a node's value owns (copied strings, packed values). Children aren't values, they're left alone.
+static void JSONNodeFreeValue(JSONNode_t* pNode) {
+    if (JSONNodeIsPackedArray(pNode)) {
+        JSONPackedArrayFree(pNode);
+    } else if (pNode->type == JSONStringType && pNode->value.str.bOwned) {
+        JSONCtxRelease(pNode->pCtx, (void*)pNode->value.str.pData, pNode->value.str.length + 1);
+        pNode->value.str.pData = NULL;
+        pNode->value.str.bOwned = false;
+    }
+}
+#pragma endregion
+
+static void JSONNodeFreeDumpCache(JSONNode_t* pNode) {
+    JSONBufferDestroy(pNode->pDumpCache);
+    JSONCtxRelease(pNode->pCtx, pNode->pDumpCache, sizeof(JSONBuffer_t));
+    pNode->pDumpCache = NULL;
+}
+/// @brief Frees a node and everything under it, without touching its parent or its siblings.
+/// Doesn't recurse: it always frees the first remaining child of the deepest node, so it only needs the parent pointers to find its way back up.
+/// @param pRoot The node to free
+static void JSONNodeFreeTree(JSONNode_t* pRoot) {
+    JSONNode_t* current = pRoot;
+    for (;;) {
+        JSONNode_t* pFirstChild = JSONNodeGetFirstChild(current);
+        if (pFirstChild != NULL) {
+            current = pFirstChild;
+            continue;
+        }
+
+        // current has no children (left), so it can go
+        JSONNode_t* pParent = current->pParent;
+        JSONNode_t* pNext = current->pNextSibling;
+        bool bRoot = current == pRoot;
+        if (current->type == JSONArrayType) {
+            JSONArrayIndexFree(&current->value.array, current->pCtx);
+        } else if (current->type == JSONObjType) {
+            JSONObjIndexFree(&current->value.children, current->pCtx);
+        } else {
+            JSONNodeFreeValue(current);
+        }
+        if (current->pDumpCache != NULL) {
+            JSONNodeFreeDumpCache(current);
+        }
+        JSONNodeFree(current);
+        if (bRoot) break;
+
+        // unlink it from its parent so the parent looks empty once all of its children are gone
+        if (pParent->type == JSONArrayType) {
+            pParent->value.array.pStart = pNext;
+            if (pNext == NULL) {
+                pParent->value.array.pEnd = NULL;
+            }
+        } else {
+            pParent->value.children.pFirstChild = pNext;
+            if (pNext == NULL) {
+                pParent->value.children.pLastChild = NULL;
+            }
+        }
+        current = pNext != NULL ? pNext : pParent;
+    }
+}
+/// @brief Destroys all elements of a JSONArray.
+/// @param pArray The array
+void JSONArrayDestroyElements(JSONArray_t* pArray) {
+    JSONArrayMustBeValid(pArray);
     
-    pNode->name = name;
-    pNode->type = type;
-    pNode->value = value;
+    if (JSONArrayIsEmpty(pArray)) {
+        return;
+    }
+
+    JSONNode_t* pParent = pArray->pStart->pParent;
+    JSONArrayIndexFree(pArray, pArray->pStart->pCtx);
+    JSONNode_t* current = pArray->pStart;
+    JSONNode_t* next;
+
+    while (current != NULL) {
+        next = current->pNextSibling;
+        JSONNodeFreeTree(current);
+        current = next;
+    }
+    pArray->pStart = NULL;
+    pArray->pEnd = NULL;
+    pArray->count = 0;
+
+    if (pParent != NULL) {
+        JSONNodeValueLengthChanged(pParent, pParent->valueLength, sizeof(JSONARRAY_START) + sizeof(JSONARRAY_END));
+    }
+}
+/// @brief Destroys all children of a JSONObj.
+/// @param pArray The obj
+void JSONObjDestroyChildren(JSONObj_t* pObj) {
+    JSONObjMustBeValid(pObj);
+
+    if (JSONObjIsEmpty(pObj)) {
+        return;
+    }
+
+    JSONNode_t* pParent = pObj->pFirstChild->pParent;
+    JSONObjIndexFree(pObj, pObj->pFirstChild->pCtx);
+    JSONNode_t* current = pObj->pFirstChild;
+    JSONNode_t* next;
+
+    while (current != NULL) {
+        next = current->pNextSibling;
+        JSONNodeFreeTree(current);
+        current = next;
+    }
+    pObj->pFirstChild = NULL;
+    pObj->pLastChild = NULL;
+    pObj->count = 0;
+
+    if (pParent != NULL) {
+        JSONNodeValueLengthChanged(pParent, pParent->valueLength, sizeof(JSONOBJ_START) + sizeof(JSONOBJ_END));
+    }
+}
+/// @brief Detaches a node whose position in its array may already be known.
+/// @param pNode The node to detach
+/// @param idx Its position if its parent is an array, or JSON_INDEX_UNKNOWN
+static void JSONNodeDetachAt(JSONNode_t* pNode, size_t idx) {
+    JSONNode_t* pParent = pNode->pParent;
+
+    if (pParent->type == JSONArrayType) {
+        JSONArray_t* pArray = &pParent->value.array;
+        if (pArray->pIndex != NULL) {
+            if (idx == JSON_INDEX_UNKNOWN) {
+                idx = pNode == pArray->pStart ? 0 : (pNode == pArray->pEnd ? pArray->count - 1 : JSON_INDEX_UNKNOWN);
+            }
+            if (idx != JSON_INDEX_UNKNOWN) {
+                JSONArrayIndexRemove(pArray, idx);
+            } else {
+                // finding it would mean walking the list, so just drop the index. It gets rebuilt on the next indexed access.
+                JSONArrayIndexFree(pArray, pParent->pCtx);
+            }
+        }
+        pArray->count--;
+    } else {
+        JSONObj_t* pObj = &pParent->value.children;
+        if (pObj->pIndex != NULL) {
+            JSONObjIndexRemove(pObj, pNode);
+        }
+        pObj->count--;
+    }
+
+    size_t removedLength = JSONNodeGetLength(pNode);
+    if (pNode->pPrevSibling != NULL || pNode->pNextSibling != NULL) {
+        removedLength = JSONAddLengths(removedLength, sizeof(CHILD_SEPARATOR));
+    }
+
+    // objects and arrays keep their children the exact same way, only the names differ
+    JSONNode_t** ppFirst = pParent->type == JSONArrayType ? &pParent->value.array.pStart : &pParent->value.children.pFirstChild;
+    JSONNode_t** ppLast = pParent->type == JSONArrayType ? &pParent->value.array.pEnd : &pParent->value.children.pLastChild;
+    if (*ppFirst == pNode) {
+        *ppFirst = pNode->pNextSibling;
+    }
+    if (*ppLast == pNode) {
+        *ppLast = pNode->pPrevSibling;
+    }
+
+    JSONNodeConnectNeighbors(pNode);
     pNode->pParent = NULL;
     pNode->pPrevSibling = NULL;
     pNode->pNextSibling = NULL;
 
-    return pNode;
+    JSONNodeValueLengthChanged(pParent, removedLength, 0);
+}
+/// @brief Unlinks a node from its parent (fixing up the parent's first/last child if needed) and from its siblings.
+/// The node and its subtree stay alive, and can be adopted somewhere else or destroyed.
+/// @param pNode The node to detach
+void JSONNodeDetach(JSONNode_t* pNode) {
+    JsonAssert(pNode != NULL);
+    JsonAssertMsg(pNode->pParent != NULL, "Tried to detach a node that doesn't have a parent !");
+    JSONNodeDetachAt(pNode, JSON_INDEX_UNKNOWN);
+}
+/// @brief Recursively destroys each JSONNode in the tree. Handles everything related to the destruction process of any kind of JSONNode. Should be called every time you need to dispose of a JSONNode. 
+/// If the node still has a parent, it gets detached from it first.
+/// @param pNode The node to destroy
+void JSONNodeDestroy(JSONNode_t* pNode) {
+    JsonAssert(pNode != NULL);
+    if (pNode->pParent != NULL) {
+        JSONNodeDetach(pNode);
+    } else {
+        JSONNodeConnectNeighbors(pNode);
+    }
+    JSONNodeFreeTree(pNode);
+}
+
+/// @brief Returns the Nth element of an array. O(1) once the array has an index (see JSON_ARRAY_INDEX_THRESHOLD), otherwise walks the list.
+/// @param pArray The array
+/// @param n The index of the element
+/// @return The node at the specified index in the array
+JSONNode_t* JSONArrayGetNthNode(JSONArray_t* pArray, size_t n) {
+    JSONArrayMustBeValid(pArray);
+    JsonAssertMsg(!JSONArrayIsEmpty(pArray), "Tried to get an element in an empty array !");
+    JsonAssertMsg(n < pArray->count, "Array indexed out of range.");
+
+#if JSON_ARRAY_INDEX_THRESHOLD > 0
+    if (pArray->pIndex == NULL && pArray->count >= JSON_ARRAY_INDEX_THRESHOLD) {
+        JSONArrayIndexBuild(pArray, pArray->pStart->pCtx);
+    }
+#endif
+    if (pArray->pIndex != NULL) {
+        return pArray->pIndex->slots[pArray->pIndex->head + n];
+    }
+
+    JSONNode_t* current = pArray->pStart;
+    for (size_t i = 0; i < n; i++) {
+        current = current->pNextSibling;
+    }
+
+    return current;
+}
+/// @brief Adds an element node to an array node
+/// @param pArrayNode The array node.
+/// @param pChild The child node.
+void JSONArrayNodeAddNode(JSONNode_t* pArrayNode, JSONNode_t* pChild) {
+    JsonAssert(pArrayNode != NULL);
+    JsonAssertMsg(pArrayNode->type == JSONArrayType, "Tried to add an array element to a node that wasn't an array ! (what are you doing :sob:)");
+
+    JSONArray_t* pArray = &pArrayNode->value.array;
+
+    // Make sure everything is valid
+    JSONArrayMustBeValid(pArray);
+    JsonAssert(pChild != NULL);
+
+    // Make sure the node isn't already used in another array, and add the parent
+    JsonAssertMsg(pChild->pParent == NULL, "Tried to add an array element, but the child node already has a parent ! Nodes should only have one reference at all times.");
+    pChild->pParent = pArrayNode;
+    pChild->pKey = NULL;
+
+    size_t addedLength = JSONNodeGetValueLength(pChild);
+    if (JSONArrayIsEmpty(pArray)) {
+        pArray->pStart = pChild;
+        pArray->pEnd = pChild;
+    } else {
+        JSONNodeInsertAfter(pArray->pEnd, pChild);
+        pArray->pEnd = pChild;
+        addedLength = JSONAddLengths(addedLength, sizeof(CHILD_SEPARATOR));
+    }
+    if (pArray->pIndex != NULL) {
+        JSONArrayIndexInsert(pArray, pArrayNode->pCtx, pArray->count, pChild);
+    }
+    pArray->count++;
+    JSONNodeValueLengthChanged(pArrayNode, 0, addedLength);
+}
+/// @brief Inserts an element node into an array node, before the element currently at the given index.
+/// @param pArrayNode The array node.
+/// @param idx Where the new element goes. Passing the number of elements (or ARRAY_POS_END) appends it.
+/// @param pChild The child node.
+void JSONArrayNodeInsertNode(JSONNode_t* pArrayNode, size_t idx, JSONNode_t* pChild) {
+    JsonAssert(pArrayNode != NULL);
+    JsonAssertMsg(pArrayNode->type == JSONArrayType, "Tried to insert an array element into a node that wasn't an array ! (what are you doing :sob:)");
+    JsonAssert(pChild != NULL);
+    JsonAssertMsg(pChild->pParent == NULL, "Tried to insert an array element, but the child node already has a parent ! Nodes should only have one reference at all times.");
+
+    JSONArray_t* pArray = &pArrayNode->value.array;
+    JSONArrayMustBeValid(pArray);
+    if (idx == ARRAY_POS_END || idx == pArray->count) {
+        JSONArrayNodeAddNode(pArrayNode, pChild);
+        return;
+    }
+    JsonAssertMsg(idx < pArray->count, "Array indexed out of range.");
+
+    JSONNode_t* pRight = JSONArrayGetNthNode(pArray, idx);
+    if (pRight->pPrevSibling != NULL) {
+        JSONNodeInsertAfter(pRight->pPrevSibling, pChild);
+    } else {
+        pChild->pNextSibling = pRight;
+        pRight->pPrevSibling = pChild;
+        pArray->pStart = pChild;
+    }
+    pChild->pParent = pArrayNode;
+    pChild->pKey = NULL;
+
+    if (pArray->pIndex != NULL) {
+        JSONArrayIndexInsert(pArray, pArrayNode->pCtx, idx, pChild);
+    }
+    pArray->count++;
+    JSONNodeValueLengthChanged(pArrayNode, 0, JSONAddLengths(JSONNodeGetValueLength(pChild), sizeof(CHILD_SEPARATOR)));
+}
+/// @brief Removes an element from an array node at a specified index
+/// @param pArrayNode The array node.
+/// @param idx The index.
+void JSONArrayNodeRemoveNode(JSONNode_t* pArrayNode, size_t idx) {
+    JsonAssert(pArrayNode != NULL);
+    JsonAssertMsg(pArrayNode->type == JSONArrayType, "Tried to remove an array element from a node that wasn't an array ! (what are you doing :sob:)");
+
+    JSONArray_t* pArray = &pArrayNode->value.array;
+
+    JSONArrayMustBeValid(pArray);
+
+    JsonAssertMsg(!JSONArrayIsEmpty(pArray), "Tried to delete node from empty array.");
+
+    if (idx == ARRAY_POS_END) {
+        idx = pArray->count - 1;
+    }
+    JSONNode_t* pNodeToDelete = JSONArrayGetNthNode(pArray, idx);
+
+    JSONNodeDetachAt(pNodeToDelete, idx);
+    JSONNodeFreeTree(pNodeToDelete);
+}
+/// @brief Creates count elements of the given type at the end of an array in a single pass: the nodes get allocated as a batch
+/// (see JSONNodeBatch_t) and linked in one loop, and the lengths of the array and its ancestors get updated once.
+/// pValues points to count int_type/float_type/doubles, or to count string pointers.
+static void JSONArrayNodeAppendValues(JSONNode_t* pArrayNode, JSONType_t type, const void* pValues, size_t count) {
+    JsonAssert(pArrayNode != NULL);
+    JsonAssertMsg(pArrayNode->type == JSONArrayType, "Tried to add array elements to a node that wasn't an array ! (what are you doing :sob:)");
+    JsonAssert(pValues != NULL || count == 0);
+
+    JSONArray_t* pArray = &pArrayNode->value.array;
+    JSONArrayMustBeValid(pArray);
+    if (count == 0) {
+        return;
+    }
+
+    JSONContext_t* pCtx = pArrayNode->pCtx;
+    JSONNodeBatch_t batch;
+    JSONNodeBatchInit(pCtx, &batch, count);
+
+    JSONNode_t* pPrev = pArray->pEnd;
+    size_t addedLength = JSONArrayIsEmpty(pArray) ? (count - 1) * sizeof(CHILD_SEPARATOR) : count * sizeof(CHILD_SEPARATOR);
+    for (size_t i = 0; i < count; i++) {
+        JSONNode_t* pNode = JSONNodeBatchNext(pCtx, &batch);
+        JSONStatsNodeAdded(pCtx, type);
+        switch (type) {
+            case JSONIntType: pNode->value.i = ((const int_type*)pValues)[i]; break;
+            case JSONFloatType: pNode->value.f = ((const float_type*)pValues)[i]; break;
+            case JSONDoubleType: pNode->value.d = ((const double*)pValues)[i]; break;
+            default: {
+                const char* str = ((const char* const*)pValues)[i];
+                JsonAssert(str != NULL);
+                pNode->value.str.pData = str;
+                pNode->value.str.length = pCtx->funcs.strlen(str);
+                pNode->value.str.bOwned = false;
+                break;
+            }
+        }
+        pNode->name = "";
+        pNode->type = type;
+        pNode->flags = batch.flags;
+        pNode->pPool = batch.pPool;
+        pNode->pCtx = pCtx;
+        pNode->pParent = pArrayNode;
+        pNode->pPrevSibling = pPrev;
+        pNode->pNextSibling = NULL;
+        pNode->pDumpCache = NULL;
+        pNode->pKey = NULL;
+        pNode->valueLength = JSONNodeComputeValueLength(pNode);
+        addedLength = JSONAddLengths(addedLength, pNode->valueLength);
+
+        if (pPrev != NULL) {
+            pPrev->pNextSibling = pNode;
+        } else {
+            pArray->pStart = pNode;
+        }
+        pPrev = pNode;
+    }
+    pArray->pEnd = pPrev;
+    pArray->count += count;
+    // cheaper to rebuild on the next indexed access than to keep up to date one element at a time
+    JSONArrayIndexFree(pArray, pCtx);
+    JSONNodeValueLengthChanged(pArrayNode, 0, addedLength);
+}
+/// @brief Adds count int elements to the end of an array in one call. Much cheaper than count JSONNodeAddIntNode calls:
+/// the nodes are allocated as a batch (one block from an arena, whole slabs from a pool) and the array's length is updated once.
+/// For numbers that never need to be nodes of their own, a packed array (JSONIntArrayNodeAppend) is cheaper still.
+/// @param pArrayNode The array node
+/// @param pValues The values
+/// @param count How many there are
+void JSONArrayNodeAppendInts(JSONNode_t* pArrayNode, const int_type* pValues, size_t count) {
+    JSONArrayNodeAppendValues(pArrayNode, JSONIntType, pValues, count);
+}
+/// @brief Same as JSONArrayNodeAppendInts, with float elements.
+void JSONArrayNodeAppendFloats(JSONNode_t* pArrayNode, const float_type* pValues, size_t count) {
+    JSONArrayNodeAppendValues(pArrayNode, JSONFloatType, pValues, count);
+}
+/// @brief Same as JSONArrayNodeAppendInts, with double elements.
+void JSONArrayNodeAppendDoubles(JSONNode_t* pArrayNode, const double* pValues, size_t count) {
+    JSONArrayNodeAppendValues(pArrayNode, JSONDoubleType, pValues, count);
+}
+/// @brief Same as JSONArrayNodeAppendInts, with string elements. The strings aren't copied, so they must outlive the nodes.
+void JSONArrayNodeAppendStrings(JSONNode_t* pArrayNode, const char* const* ppValues, size_t count) {
+    JSONArrayNodeAppendValues(pArrayNode, JSONStringType, ppValues, count);
+}
+/// @brief Adds count existing nodes to the end of an array in one call, updating the lengths of the array and its ancestors once instead of once per node.
+/// @param pArrayNode The array node
+/// @param ppNodes The nodes, in order. None of them can have a parent.
+/// @param count How many there are
+void JSONArrayNodeAppendNodes(JSONNode_t* pArrayNode, JSONNode_t* const* ppNodes, size_t count) {
+    JsonAssert(pArrayNode != NULL);
+    JsonAssertMsg(pArrayNode->type == JSONArrayType, "Tried to add array elements to a node that wasn't an array ! (what are you doing :sob:)");
+    JsonAssert(ppNodes != NULL || count == 0);
+
+    JSONArray_t* pArray = &pArrayNode->value.array;
+    JSONArrayMustBeValid(pArray);
+    if (count == 0) {
+        return;
+    }
+
+    JSONNode_t* pPrev = pArray->pEnd;
+    size_t addedLength = JSONArrayIsEmpty(pArray) ? (count - 1) * sizeof(CHILD_SEPARATOR) : count * sizeof(CHILD_SEPARATOR);
+    for (size_t i = 0; i < count; i++) {
+        JSONNode_t* pNode = ppNodes[i];
+        JsonAssert(pNode != NULL);
+        JsonAssertMsg(pNode->pParent == NULL, "Tried to add an array element, but the child node already has a parent ! Nodes should only have one reference at all times.");
+        JsonAssertMsg(pNode != pArrayNode, "Tried to add an array to itself !");
+        pNode->pParent = pArrayNode;
+        pNode->pKey = NULL;
+        pNode->pPrevSibling = pPrev;
+        pNode->pNextSibling = NULL;
+        addedLength = JSONAddLengths(addedLength, JSONNodeGetValueLength(pNode));
+
+        if (pPrev != NULL) {
+            pPrev->pNextSibling = pNode;
+        } else {
+            pArray->pStart = pNode;
+        }
+        pPrev = pNode;
+    }
+    pArray->pEnd = pPrev;
+    pArray->count += count;
+    JSONArrayIndexFree(pArray, pArrayNode->pCtx);
+    JSONNodeValueLengthChanged(pArrayNode, 0, addedLength);
+}
+void JSONArrayNodeRemoveAllNodes(JSONNode_t* pNode) {
+    JsonAssert(pNode != NULL);
+    JsonAssertMsg(pNode->type == JSONArrayType, "Tried to remove elements from a node that wasn't an array ! (what are you doing :sob:)");
+
+    JSONArrayDestroyElements(&pNode->value.array);
+}
+
+void JSONNodeAdoptChildNode(JSONNode_t* pParent, JSONNode_t* pChild) {
+    JsonAssert(pParent != NULL);
+    JsonAssert(pChild != NULL);
+    JsonAssertMsg(pChild->pParent == NULL, "Tried to adopt a child node, but the child node already has a parent ! Nodes should only have one reference at all times.");
+    JsonAssertMsg(JSONNodeCanHaveChildren(pParent), "Tried to add a child node to a node that can't have children !");
+
+    if (pParent->type == JSONArrayType) {
+        JSONArrayNodeAddNode(pParent, pChild);
+        return;
+    }
+
+    pChild->pParent = pParent;
+
+    JSONNodeUpdateKey(pChild);
+
+    JSONObj_t* pChildren = &pParent->value.children;
+    JSONObjMustBeValid(pChildren);
+    
+    size_t addedLength = JSONNodeGetLength(pChild);
+    if (JSONObjIsEmpty(pChildren)) {
+        pChildren->pFirstChild = pChild;
+    } else {
+        JSONNodeInsertAfter(pChildren->pLastChild, pChild);
+        addedLength = JSONAddLengths(addedLength, sizeof(CHILD_SEPARATOR));
+    }
+    pChildren->pLastChild = pChild;
+    pChildren->count++;
+    if (pChildren->pIndex != NULL) {
+        (void)JSONObjIndexAdd(pChildren, pParent->pCtx, pChild);
+    }
+    JSONNodeValueLengthChanged(pParent, 0, addedLength);
+}
+
+/// @brief Finds the child of an object with the given name. If several children have that name, it's the first one.
+/// Objects with at least JSON_OBJ_INDEX_THRESHOLD children build a hash index of their keys on the first lookup, after that lookups are O(1).
+/// @param pObj The object
+/// @param name The name to look for
+/// @return The child, or NULL if there's none with that name
+JSONNode_t* JSONObjGetChild(JSONObj_t* pObj, const char* name) {
+    JSONObjMustBeValid(pObj);
+    JsonAssert(name != NULL);
+
+    if (JSONObjIsEmpty(pObj)) {
+        return NULL;
+    }
+#if JSON_OBJ_INDEX_THRESHOLD > 0
+    if (pObj->pIndex == NULL && pObj->count >= JSON_OBJ_INDEX_THRESHOLD) {
+        JSONObjIndexBuild(pObj, pObj->pFirstChild->pCtx);
+    }
+#endif
+    if (pObj->pIndex != NULL) {
+        size_t length;
+        return JSONObjIndexFind(pObj->pIndex, name, JSONHashKey(name, &length))->pNode;
+    }
+
+    for (JSONNode_t* current = pObj->pFirstChild; current != NULL; current = current->pNextSibling) {
+        if (JSONNamesEqual(current->name, name)) {
+            return current;
+        }
+    }
+    return NULL;
+}
+/// @brief Puts pNew where pOld is in an object, and destroys pOld. They must have the same name.
+static void JSONObjNodeReplaceChild(JSONNode_t* pObjNode, JSONNode_t* pOld, JSONNode_t* pNew) {
+    JSONObj_t* pObj = &pObjNode->value.children;
+    size_t oldLength = JSONNodeGetLength(pOld);
+
+    pNew->pParent = pObjNode;
+    pNew->pPrevSibling = pOld->pPrevSibling;
+    pNew->pNextSibling = pOld->pNextSibling;
+    if (pNew->pPrevSibling != NULL) {
+        pNew->pPrevSibling->pNextSibling = pNew;
+    } else {
+        pObj->pFirstChild = pNew;
+    }
+    if (pNew->pNextSibling != NULL) {
+        pNew->pNextSibling->pPrevSibling = pNew;
+    } else {
+        pObj->pLastChild = pNew;
+    }
+    JSONNodeUpdateKey(pNew);
+
+    if (pObj->pIndex != NULL) {
+        struct JSONObjIndexSlot* pSlot = JSONObjIndexFind(pObj->pIndex, pOld->name, JSONNodeHashName(pOld));
+        if (pSlot->pNode == pOld) {
+            pSlot->pNode = pNew;
+        }
+    }
+
+    pOld->pParent = NULL;
+    pOld->pPrevSibling = NULL;
+    pOld->pNextSibling = NULL;
+    JSONNodeFreeTree(pOld);
+
+    JSONNodeValueLengthChanged(pObjNode, oldLength, JSONNodeGetLength(pNew));
+}
+/// @brief Adds a child to an object, or replaces the child that already has its name (which gets destroyed).
+/// A replacement takes the place of the child it replaces, so the order of the object's keys doesn't change.
+/// @param pObjNode The object node
+/// @param pChild The new child. Must not have a parent.
+void JSONObjNodeSetChild(JSONNode_t* pObjNode, JSONNode_t* pChild) {
+    JsonAssert(pObjNode != NULL);
+    JsonAssert(pChild != NULL);
+    JsonAssertMsg(pObjNode->type == JSONObjType, "Tried to set a child by name in a node that wasn't an object !");
+    JsonAssertMsg(pChild->pParent == NULL, "Tried to adopt a child node, but the child node already has a parent ! Nodes should only have one reference at all times.");
+
+    JSONNode_t* pOld = JSONObjGetChild(&pObjNode->value.children, pChild->name);
+    if (pOld == NULL) {
+        JSONNodeAdoptChildNode(pObjNode, pChild);
+    } else {
+        JSONObjNodeReplaceChild(pObjNode, pOld, pChild);
+    }
+}
+/// @brief Destroys the child of an object with the given name (the first one, if several have it).
+/// @param pObjNode The object node
+/// @param name The name of the child
+/// @return Whether there was a child with that name
+bool JSONObjNodeRemoveChild(JSONNode_t* pObjNode, const char* name) {
+    JsonAssert(pObjNode != NULL);
+    JsonAssertMsg(pObjNode->type == JSONObjType, "Tried to remove a child by name from a node that wasn't an object !");
+
+    JSONNode_t* pChild = JSONObjGetChild(&pObjNode->value.children, name);
+    if (pChild == NULL) {
+        return false;
+    }
+    JSONNodeDetachAt(pChild, JSON_INDEX_UNKNOWN);
+    JSONNodeFreeTree(pChild);
+    return true;
+}
+/// @brief Finds the child a scalar upsert can overwrite in place. NULL if there's none, or if it's an object/array (which has to be replaced instead).
+static JSONNode_t* JSONObjNodeGetScalarChild(JSONNode_t* pObjNode, const char* name) {
+    JsonAssert(pObjNode != NULL);
+    JsonAssertMsg(pObjNode->type == JSONObjType, "Tried to set a child by name in a node that wasn't an object !");
+    JSONNode_t* pChild = JSONObjGetChild(&pObjNode->value.children, name);
+    return pChild != NULL && !JSONNodeCanHaveChildren(pChild) ? pChild : NULL;
+}
+/// @brief Sets the value of an object's child by name, adding the child if there's none with that name yet.
+/// The existing child gets updated in place (no allocation). The name is only referenced if a child gets added, in which case it must outlive it.
+void JSONObjNodeSetNamedBool(JSONNode_t* pObjNode, const char* name, bool value) {
+    JSONNode_t* pChild = JSONObjNodeGetScalarChild(pObjNode, name);
+    if (pChild != NULL) {
+        JSONNodeSetBool(pChild, value);
+    } else {
+        JSONObjNodeSetChild(pObjNode, JSONCtxCreateNamedBoolNode(pObjNode->pCtx, name, value));
+    }
+}
+void JSONObjNodeSetNamedInt(JSONNode_t* pObjNode, const char* name, int_type value) {
+    JSONNode_t* pChild = JSONObjNodeGetScalarChild(pObjNode, name);
+    if (pChild != NULL) {
+        JSONNodeSetInt(pChild, value);
+    } else {
+        JSONObjNodeSetChild(pObjNode, JSONCtxCreateNamedIntNode(pObjNode->pCtx, name, value));
+    }
+}
+void JSONObjNodeSetNamedFloat(JSONNode_t* pObjNode, const char* name, float_type value) {
+    JSONNode_t* pChild = JSONObjNodeGetScalarChild(pObjNode, name);
+    if (pChild != NULL) {
+        JSONNodeSetFloat(pChild, value);
+    } else {
+        JSONObjNodeSetChild(pObjNode, JSONCtxCreateNamedFloatNode(pObjNode->pCtx, name, value));
+    }
+}
+void JSONObjNodeSetNamedDouble(JSONNode_t* pObjNode, const char* name, double value) {
+    JSONNode_t* pChild = JSONObjNodeGetScalarChild(pObjNode, name);
+    if (pChild != NULL) {
+        JSONNodeSetDouble(pChild, value);
+    } else {
+        JSONObjNodeSetChild(pObjNode, JSONCtxCreateNamedDoubleNode(pObjNode->pCtx, name, value));
+    }
+}
+/// @brief Same as JSONObjNodeSetNamedBool, for strings. The string isn't copied, so it must outlive the node.
+void JSONObjNodeSetNamedString(JSONNode_t* pObjNode, const char* name, const char* value) {
+    JSONNode_t* pChild = JSONObjNodeGetScalarChild(pObjNode, name);
+    if (pChild != NULL) {
+        JSONNodeSetString(pChild, value);
+    } else {
+        JSONObjNodeSetChild(pObjNode, JSONCtxCreateNamedStrNode(pObjNode->pCtx, name, value));
+    }
+}
+
+/// @brief Renames a node, keeping the lengths of its ancestors up to date.
+/// @param pNode The node
+/// @param name The new name. Not copied, so it must outlive the node.
+void JSONNodeSetName(JSONNode_t* pNode, const char* name) {
+    JsonAssert(pNode != NULL);
+    JsonAssert(name != NULL);
+    size_t oldLength = JSONNodeGetPreValLength(pNode);
+    JSONObj_t* pIndexedObj = NULL;
+    if (pNode->pParent != NULL && pNode->pParent->type == JSONObjType && pNode->pParent->value.children.pIndex != NULL) {
+        pIndexedObj = &pNode->pParent->value.children;
+        JSONObjIndexRemove(pIndexedObj, pNode);
+    }
+    pNode->name = name;
+    JSONNodeUpdateKey(pNode);
+    if (pIndexedObj != NULL && !JSONObjIndexAdd(pIndexedObj, pNode->pCtx, pNode)) {
+        // another child already has that name, and which of the two comes first isn't known without walking the list,
+        // so just drop the index. It gets rebuilt on the next lookup.
+        JSONObjIndexFree(pIndexedObj, pNode->pCtx);
+    }
+    JSONNodeValueLengthChanged(pNode->pParent, oldLength, JSONNodeGetPreValLength(pNode));
+}
+/// @brief Replaces the value of a node in place. A node can switch between any of the value types this way, but objects and arrays have to stay what they are.
+static void JSONNodeSetValue(JSONNode_t* pNode, JSONType_t type, JSONValue_t value) {
+    JsonAssert(pNode != NULL);
+    JsonAssertMsg(!JSONNodeCanHaveChildren(pNode), "Tried to overwrite the value of an object or array ! Destroy its children instead.");
+    JSONNodeFreeValue(pNode);
+    JSONStatsNodeRemoved(pNode->pCtx, pNode->type);
+    JSONStatsNodeAdded(pNode->pCtx, type);
+    pNode->type = type;
+    pNode->value = value;
+    JSONNodeValueLengthChanged(pNode, pNode->valueLength, JSONNodeComputeValueLength(pNode));
+}
+void JSONNodeSetNull(JSONNode_t* pNode) {
+    JSONValue_t jsonValue = {.i = 0};
+    JSONNodeSetValue(pNode, JSONNullType, jsonValue);
+}
+void JSONNodeSetBool(JSONNode_t* pNode, bool value) {
+    JSONValue_t jsonValue = {.b = value};
+    JSONNodeSetValue(pNode, JSONBoolType, jsonValue);
+}
+void JSONNodeSetInt(JSONNode_t* pNode, int_type value) {
+    JSONValue_t jsonValue = {.i = value};
+    JSONNodeSetValue(pNode, JSONIntType, jsonValue);
+}
+void JSONNodeSetFloat(JSONNode_t* pNode, float_type value) {
+    JSONValue_t jsonValue = {.f = value};
+    JSONNodeSetValue(pNode, JSONFloatType, jsonValue);
+}
+void JSONNodeSetDouble(JSONNode_t* pNode, double value) {
+    JSONValue_t jsonValue = {.d = value};
+    JSONNodeSetValue(pNode, JSONDoubleType, jsonValue);
+}
+void JSONNodeSetString(JSONNode_t* pNode, const char* value) {
+    JsonAssert(pNode != NULL);
+    JsonAssert(value != NULL);
+    JSONNodeSetStringWithLength(pNode, value, pNode->pCtx->funcs.strlen(value), false);
+}
+/// @brief Sets a string value whose length is already known. It doesn't have to be null-terminated, so it can be a slice of a bigger buffer.
+/// @param pNode The node
+/// @param value The string
+/// @param length Its length
+/// @param bCopy Whether to copy it (into the context's active arena, or its malloc). If false, it's borrowed and must outlive the node.
+void JSONNodeSetStringWithLength(JSONNode_t* pNode, const char* value, size_t length, bool bCopy) {
+    JsonAssert(pNode != NULL);
+    JSONNodeSetValue(pNode, JSONStringType, JSONCtxMakeStringValue(pNode->pCtx, value, length, bCopy));
+}
+/// @brief Makes a node hold already serialized JSON, which gets dumped as is.
+/// @param pNode The node
+/// @param json A single JSON value. Not copied, so it must outlive the node. Checked with JSONValidate if JSON_VALIDATE_RAW is on.
+/// @param length Its length
+void JSONNodeSetRaw(JSONNode_t* pNode, const char* json, size_t length) {
+    JSONRawMustBeValid(json, length);
+    JSONValue_t jsonValue = {.raw = {json, length}};
+    JSONNodeSetValue(pNode, JSONRawType, jsonValue);
+}
+/// @brief Turns on (or off) caching the dumped bytes of an object or array.
+/// A cached subtree only gets walked again when something in it changed since the last dump; otherwise its bytes are just copied.
+/// Best for big subtrees where only a few values change between dumps. The cache is freed along with the node,
+/// except for arena-allocated trees, where it has to be turned off before JSONArenaReset.
+/// @param pNode The object or array node
+/// @param bEnable Whether to cache its bytes
+void JSONNodeSetDumpCache(JSONNode_t* pNode, bool bEnable) {
+    JsonAssert(pNode != NULL);
+    JsonAssertMsg(JSONNodeCanHaveChildren(pNode), "Only objects and arrays can cache their dumped bytes !");
+
+    if (!bEnable) {
+        if (pNode->pDumpCache != NULL) {
+            JSONNodeFreeDumpCache(pNode);
+        }
+        return;
+    }
+    if (pNode->pDumpCache != NULL) return;
+
+    JSONBuffer_t* pCache = (JSONBuffer_t*)JSONCtxAlloc(pNode->pCtx, sizeof(JSONBuffer_t));
+    JsonAssert(pCache != NULL);
+    JSONCtxBufferInit(pNode->pCtx, pCache, 0);
+    pNode->pDumpCache = pCache;
+    pNode->flags |= JSON_NODE_FLAG_DIRTY;
+}
+/// @brief Creates a node through a context: it gets allocated from the context's arena/pool/malloc, and gets freed through the same context.
+JSONNode_t* JSONCtxCreateNode(JSONContext_t* pCtx, const char* name, JSONType_t type, JSONValue_t value) {
+    JsonAssert(pCtx != NULL);
+    uint8_t flags;
+    JSONNodePool_t* pPool;
+    JSONNode_t* pNode = JSONNodeAlloc(pCtx, &flags, &pPool);
+    JSONStatsNodeAdded(pCtx, type);
+
+    pNode->name = name;
+    pNode->type = type;
+    pNode->flags = flags;
+    pNode->pPool = pPool;
+    pNode->value = value;
+    pNode->pCtx = pCtx;
+    pNode->pParent = NULL;
+    pNode->pPrevSibling = NULL;
+    pNode->pNextSibling = NULL;
+    pNode->pDumpCache = NULL;
+    pNode->pKey = NULL;
+    pNode->valueLength = JSONNodeComputeValueLength(pNode);
+
+    return pNode;
+}
+JSONNode_t* JSONCreateNode(const char* name, JSONType_t type, JSONValue_t value) {
+    return JSONCtxCreateNode(&defaultContext, name, type, value);
+}
+
+JSONNode_t* JSONCtxCreateNamedNullNode(JSONContext_t* pCtx, const char* name) {
+    JSONValue_t jsonValue = {.i = 0};
+    return JSONCtxCreateNode(pCtx, name, JSONNullType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNamedBoolNode(JSONContext_t* pCtx, const char* name, bool value) {
+    JSONValue_t jsonValue = {.b = value};
+    return JSONCtxCreateNode(pCtx, name, JSONBoolType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNamedIntNode(JSONContext_t* pCtx, const char* name, int_type value) {
+    JSONValue_t jsonValue = {.i = value};
+    return JSONCtxCreateNode(pCtx, name, JSONIntType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNamedFloatNode(JSONContext_t* pCtx, const char* name, float_type value) {
+    JSONValue_t jsonValue = {.f = value};
+    return JSONCtxCreateNode(pCtx, name, JSONFloatType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNamedDoubleNode(JSONContext_t* pCtx, const char* name, double value) {
+    JSONValue_t jsonValue = {.d = value};
+    return JSONCtxCreateNode(pCtx, name, JSONDoubleType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNamedStrNode(JSONContext_t* pCtx, const char* name, const char* value) {
+    JsonAssert(value != NULL);
+    return JSONCtxCreateNamedStrNodeWithLength(pCtx, name, value, pCtx->funcs.strlen(value), false);
+}
+/// @brief Creates a string node whose length is already known, see JSONNodeSetStringWithLength.
+JSONNode_t* JSONCtxCreateNamedStrNodeWithLength(JSONContext_t* pCtx, const char* name, const char* value, size_t length, bool bCopy) {
+    JsonAssert(pCtx != NULL);
+    return JSONCtxCreateNode(pCtx, name, JSONStringType, JSONCtxMakeStringValue(pCtx, value, length, bCopy));
+}
+/// @brief Creates a node holding already serialized JSON, which gets dumped as is (see JSONNodeSetRaw).
+JSONNode_t* JSONCtxCreateNamedRawNode(JSONContext_t* pCtx, const char* name, const char* json, size_t length) {
+    JSONRawMustBeValid(json, length);
+    JSONValue_t jsonValue = {.raw = {json, length}};
+    return JSONCtxCreateNode(pCtx, name, JSONRawType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNewNamedObjNode(JSONContext_t* pCtx, const char* name) {
+    JSONValue_t jsonValue;
+    (void)pCtx->funcs.memset(&jsonValue, 0, sizeof(JSONValue_t));
+    return JSONCtxCreateNode(pCtx, name, JSONObjType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNewNamedArrayNode(JSONContext_t* pCtx, const char* name) {
+    JSONValue_t jsonValue;
+    (void)pCtx->funcs.memset(&jsonValue, 0, sizeof(JSONValue_t));
+    return JSONCtxCreateNode(pCtx, name, JSONArrayType, jsonValue);
+}
+JSONNode_t* JSONCtxCreateNewObjNode(JSONContext_t* pCtx) {
+    return JSONCtxCreateNewNamedObjNode(pCtx, "");
+}
+JSONNode_t* JSONCtxCreateNewArrayNode(JSONContext_t* pCtx) {
+    return JSONCtxCreateNewNamedArrayNode(pCtx, "");
+}
+/// @brief Creates a packed array node, either pointing at the caller's values or holding its own copy of them.
+static JSONNode_t* JSONCtxCreateNamedPackedArrayNode(JSONContext_t* pCtx, const char* name, JSONType_t type, const void* pValues, size_t count, bool bCopy) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(pValues != NULL || count == 0);
+    JSONValue_t jsonValue;
+    (void)pCtx->funcs.memset(&jsonValue, 0, sizeof(JSONValue_t));
+    jsonValue.packed.count = count;
+    if (bCopy) {
+        if (count > 0) {
+            jsonValue.packed.pData = JSONPackedArrayAlloc(pCtx, type, count, &jsonValue.packed.bArena);
+            (void)pCtx->funcs.memcpy(jsonValue.packed.pData, pValues, count * JSONPackedArrayGetElementSize(type));
+            jsonValue.packed.capacity = count;
+        }
+    } else {
+        jsonValue.packed.pData = (void*)pValues;
+        jsonValue.packed.bBorrowed = true;
+    }
+    return JSONCtxCreateNode(pCtx, name, type, jsonValue);
+}
+/// @brief Creates a packed int array node.
+/// @param pCtx The context
+/// @param name The name of the node
+/// @param pValues The values
+/// @param count How many there are
+/// @param bCopy Whether to copy the values. If false, they're borrowed and must outlive the node (or stay until the first append).
+JSONNode_t* JSONCtxCreateNamedIntArrayNode(JSONContext_t* pCtx, const char* name, const int_type* pValues, size_t count, bool bCopy) {
+    return JSONCtxCreateNamedPackedArrayNode(pCtx, name, JSONIntArrayType, pValues, count, bCopy);
+}
+/// @brief Creates a packed float array node. Same as JSONCtxCreateNamedIntArrayNode, with float_type values.
+JSONNode_t* JSONCtxCreateNamedFloatArrayNode(JSONContext_t* pCtx, const char* name, const float_type* pValues, size_t count, bool bCopy) {
+    return JSONCtxCreateNamedPackedArrayNode(pCtx, name, JSONFloatArrayType, pValues, count, bCopy);
+}
+/// @brief Creates an object node that takes over the children listed in pObj, and pObj itself: the node keeps the list inline,
+/// so pObj gets freed right away (through the context's free, so it must come from the same malloc).
+static JSONNode_t* JSONCtxCreateNamedObjNodeFromList(JSONContext_t* pCtx, const char* name, JSONObj_t* pObj) {
+    JSONObjMustBeValid(pObj);
+    JSONValue_t jsonValue = {.children=*pObj};
+    JSONNode_t* pNode = JSONCtxCreateNode(pCtx, name, JSONObjType, jsonValue);
+    pNode->value.children.count = 0;
+    pNode->value.children.pIndex = NULL;
+    for (JSONNode_t* current = pObj->pFirstChild; current != NULL; current = current->pNextSibling) {
+        current->pParent = pNode;
+        JSONNodeUpdateKey(current);
+        pNode->value.children.count++;
+    }
+    // the children's keys only count once they have an object as their parent
+    pNode->valueLength = JSONNodeComputeValueLength(pNode);
+    pCtx->funcs.free(pObj);
+    return pNode;
+}
+/// @brief Creates an array node that takes over the elements listed in pArray, and pArray itself, which gets freed like pObj in JSONCtxCreateNamedObjNodeFromList.
+static JSONNode_t* JSONCtxCreateNamedArrayNodeFromList(JSONContext_t* pCtx, const char* name, JSONArray_t* pArray) {
+    JSONArrayMustBeValid(pArray);
+    JSONValue_t jsonValue = {.array=*pArray};
+    JSONNode_t* pNode = JSONCtxCreateNode(pCtx, name, JSONArrayType, jsonValue);
+    pNode->value.array.count = 0;
+    pNode->value.array.pIndex = NULL;
+    for (JSONNode_t* current = pArray->pStart; current != NULL; current = current->pNextSibling) {
+        current->pParent = pNode;
+        pNode->value.array.count++;
+    }
+    pNode->valueLength = JSONNodeComputeValueLength(pNode);
+    pCtx->funcs.free(pArray);
+    return pNode;
+}
+
+JSONNode_t* JSONCreateNamedNullNode(const char* name) {
+    return JSONCtxCreateNamedNullNode(&defaultContext, name);
+}
+JSONNode_t* JSONCreateNamedBoolNode(const char* name, bool value) {
+    return JSONCtxCreateNamedBoolNode(&defaultContext, name, value);
+}
+JSONNode_t* JSONCreateNamedIntNode(const char* name, int_type value) {
+    return JSONCtxCreateNamedIntNode(&defaultContext, name, value);
+}
+JSONNode_t* JSONCreateNamedFloatNode(const char* name, float_type value) {
+    return JSONCtxCreateNamedFloatNode(&defaultContext, name, value);
+}
+JSONNode_t* JSONCreateNamedDoubleNode(const char* name, double value) {
+    return JSONCtxCreateNamedDoubleNode(&defaultContext, name, value);
+}
+JSONNode_t* JSONCreateNamedStrNode(const char* name, const char* value) {
+    return JSONCtxCreateNamedStrNode(&defaultContext, name, value);
+}
+JSONNode_t* JSONCreateNamedStrNodeWithLength(const char* name, const char* value, size_t length, bool bCopy) {
+    return JSONCtxCreateNamedStrNodeWithLength(&defaultContext, name, value, length, bCopy);
+}
+JSONNode_t* JSONCreateNamedRawNode(const char* name, const char* json, size_t length) {
+    return JSONCtxCreateNamedRawNode(&defaultContext, name, json, length);
+}
+JSONNode_t* JSONCreateNewNamedObjNode(const char* name) {
+    return JSONCtxCreateNewNamedObjNode(&defaultContext, name);
+}
+JSONNode_t* JSONCreateNamedObjNode(const char* name, JSONObj_t* pObj) {
+    return JSONCtxCreateNamedObjNodeFromList(&defaultContext, name, pObj);
+}
+JSONNode_t* JSONCreateNewNamedArrayNode(const char* name) {
+    return JSONCtxCreateNewNamedArrayNode(&defaultContext, name);
+}
+JSONNode_t* JSONCreateNamedArrayNode(const char* name, JSONArray_t* pArray) {
+    return JSONCtxCreateNamedArrayNodeFromList(&defaultContext, name, pArray);
+}
+
+JSONNode_t* JSONCreateNamedIntArrayNode(const char* name, const int_type* pValues, size_t count, bool bCopy) {
+    return JSONCtxCreateNamedIntArrayNode(&defaultContext, name, pValues, count, bCopy);
+}
+JSONNode_t* JSONCreateNamedFloatArrayNode(const char* name, const float_type* pValues, size_t count, bool bCopy) {
+    return JSONCtxCreateNamedFloatArrayNode(&defaultContext, name, pValues, count, bCopy);
+}
+
+JSONNode_t* JSONCreateNullNode() {
+    return JSONCreateNamedNullNode("");
+}
+JSONNode_t* JSONCreateBoolNode(bool value) {
+    return JSONCreateNamedBoolNode("", value);
+}
+JSONNode_t* JSONCreateIntNode(int_type value) {
+    return JSONCreateNamedIntNode("", value);
+}
+JSONNode_t* JSONCreateFloatNode(float_type value) {
+    return JSONCreateNamedFloatNode("", value);
+}
+JSONNode_t* JSONCreateDoubleNode(double value) {
+    return JSONCreateNamedDoubleNode("", value);
+}
+JSONNode_t* JSONCreateStrNode(const char* value) {
+    return JSONCreateNamedStrNode("", value);
+}
+JSONNode_t* JSONCreateStrNodeWithLength(const char* value, size_t length, bool bCopy) {
+    return JSONCreateNamedStrNodeWithLength("", value, length, bCopy);
+}
+JSONNode_t* JSONCreateRawNode(const char* json, size_t length) {
+    return JSONCreateNamedRawNode("", json, length);
+}
+JSONNode_t* JSONCreateNewObjNode() {
+    return JSONCreateNewNamedObjNode("");
+}
+JSONNode_t* JSONCreateObjNode(JSONObj_t* pObj) {
+    return JSONCreateNamedObjNode("", pObj);
+}
+JSONNode_t* JSONCreateNewArrayNode() {
+    return JSONCreateNewNamedArrayNode("");
+}
+JSONNode_t* JSONCreateArrayNode(JSONArray_t* pArray) {
+    return JSONCreateNamedArrayNode("", pArray);
+}
+JSONNode_t* JSONCreateIntArrayNode(const int_type* pValues, size_t count, bool bCopy) {
+    return JSONCreateNamedIntArrayNode("", pValues, count, bCopy);
+}
+JSONNode_t* JSONCreateFloatArrayNode(const float_type* pValues, size_t count, bool bCopy) {
+    return JSONCreateNamedFloatArrayNode("", pValues, count, bCopy);
+}
+
+// Children are created through the same context as their parent
+void JSONNodeAddNamedNullNode(JSONNode_t* pParent, const char* name) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedNullNode(pParent->pCtx, name);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedBoolNode(JSONNode_t* pParent, const char* name, bool value) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedBoolNode(pParent->pCtx, name, value);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedIntNode(JSONNode_t* pParent, const char* name, int_type value) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedIntNode(pParent->pCtx, name, value);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedFloatNode(JSONNode_t* pParent, const char* name, float_type value) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedFloatNode(pParent->pCtx, name, value);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedDoubleNode(JSONNode_t* pParent, const char* name, double value) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedDoubleNode(pParent->pCtx, name, value);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedStringNode(JSONNode_t* pParent, const char* name, const char* value) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedStrNode(pParent->pCtx, name, value);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedStringNodeWithLength(JSONNode_t* pParent, const char* name, const char* value, size_t length, bool bCopy) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedStrNodeWithLength(pParent->pCtx, name, value, length, bCopy);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedRawNode(JSONNode_t* pParent, const char* name, const char* json, size_t length) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedRawNode(pParent->pCtx, name, json, length);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNewNamedObjNode(JSONNode_t* pParent, const char* name) {
+    JSONNode_t* pNewNode = JSONCtxCreateNewNamedObjNode(pParent->pCtx, name);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedObjNode(JSONNode_t* pParent, const char* name, JSONObj_t* pObj) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedObjNodeFromList(pParent->pCtx, name, pObj);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNewNamedArrayNode(JSONNode_t* pParent, const char* name) {
+    JSONNode_t* pNewNode = JSONCtxCreateNewNamedArrayNode(pParent->pCtx, name);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedArrayNode(JSONNode_t* pParent, const char* name, JSONArray_t* pArray) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedArrayNodeFromList(pParent->pCtx, name, pArray);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedIntArrayNode(JSONNode_t* pParent, const char* name, const int_type* pValues, size_t count, bool bCopy) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedIntArrayNode(pParent->pCtx, name, pValues, count, bCopy);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+void JSONNodeAddNamedFloatArrayNode(JSONNode_t* pParent, const char* name, const float_type* pValues, size_t count, bool bCopy) {
+    JSONNode_t* pNewNode = JSONCtxCreateNamedFloatArrayNode(pParent->pCtx, name, pValues, count, bCopy);
+    JSONNodeAdoptChildNode(pParent, pNewNode);
+}
+
+void JSONNodeAddNullNode(JSONNode_t* pParent) {
+    JSONNodeAddNamedNullNode(pParent, "");
+}
+void JSONNodeAddBoolNode(JSONNode_t* pParent, bool value) {
+    JSONNodeAddNamedBoolNode(pParent, "", value);
+}
+void JSONNodeAddIntNode(JSONNode_t* pParent, int_type value) {
+    JSONNodeAddNamedIntNode(pParent, "", value);
+}
+void JSONNodeAddFloatNode(JSONNode_t* pParent, float_type value) {
+    JSONNodeAddNamedFloatNode(pParent, "", value);
+}
+void JSONNodeAddDoubleNode(JSONNode_t* pParent, double value) {
+    JSONNodeAddNamedDoubleNode(pParent, "", value);
+}
+void JSONNodeAddStringNode(JSONNode_t* pParent, const char* value) {
+    JSONNodeAddNamedStringNode(pParent, "", value);
+}
+void JSONNodeAddStringNodeWithLength(JSONNode_t* pParent, const char* value, size_t length, bool bCopy) {
+    JSONNodeAddNamedStringNodeWithLength(pParent, "", value, length, bCopy);
+}
+void JSONNodeAddRawNode(JSONNode_t* pParent, const char* json, size_t length) {
+    JSONNodeAddNamedRawNode(pParent, "", json, length);
+}
+void JSONNodeAddNewObjNode(JSONNode_t* pParent) {
+    JSONNodeAddNewNamedObjNode(pParent, "");
+}
+void JSONNodeAddObjNode(JSONNode_t* pParent, JSONObj_t* pObj) {
+    JSONNodeAddNamedObjNode(pParent, "", pObj);
+}
+void JSONNodeAddNewArrayNode(JSONNode_t* pParent) {
+    JSONNodeAddNewNamedArrayNode(pParent, "");
+}
+void JSONNodeAddArrayNode(JSONNode_t* pParent, JSONArray_t* pArray) {
+    JSONNodeAddNamedArrayNode(pParent, "", pArray);
+}
+void JSONNodeAddIntArrayNode(JSONNode_t* pParent, const int_type* pValues, size_t count, bool bCopy) {
+    JSONNodeAddNamedIntArrayNode(pParent, "", pValues, count, bCopy);
+}
+void JSONNodeAddFloatArrayNode(JSONNode_t* pParent, const float_type* pValues, size_t count, bool bCopy) {
+    JSONNodeAddNamedFloatArrayNode(pParent, "", pValues, count, bCopy);
+}
+
+// for these i'm not using int_type because i chose to adhere to libc functions' return types instead (i.e. sizeof and strlen are size_t, snprintf returns int)
+// that also means lengths don't depend on how small int_type is configured, and sums that don't fit in a size_t saturate at JSON_LENGTH_OVERFLOW instead of wrapping around
+
+/// @brief Gets the length of a node's key followed by a ':'.
+/// @param pNode The node
+/// @return The length
+size_t JSONNodeGetPreValLength(JSONNode_t* pNode) {
+    if (pNode->pParent != NULL) {
+        if (pNode->pParent->type == JSONObjType) {
+            if (pNode->pKey != NULL) {
+                return pNode->pKey->fragmentLength;
+            }
+            return JSONAddLengths(JSONGetEscapedLength(pNode->name, pNode->pCtx->funcs.strlen(pNode->name)), sizeof(STRING_DELIM) + sizeof(STRING_DELIM) + sizeof(KEYVAL_SEPARATOR));
+        }
+    }
+    return 0;
+}
+static size_t JSONBoolNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode->type == JSONBoolType);
+    return pNode->value.b ? 4 : 5;
+}
+static size_t JSONIntNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode->type == JSONIntType);
+    return JSONIntGetFormattedLength(pNode->value.i);
+}
+static size_t JSONFloatNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode->type == JSONFloatType);
+    char scratch[JSON_NUMBER_MAX_CHARS];
+    return JSONFormatFloatType(scratch, pNode->value.f);
+}
+static size_t JSONDoubleNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode->type == JSONDoubleType);
+    char scratch[JSON_NUMBER_MAX_CHARS];
+    return JSONFormatDouble(scratch, pNode->value.d);
+}
+static size_t JSONStringNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode->type == JSONStringType);
+    return JSONAddLengths(JSONGetEscapedLength(pNode->value.str.pData, pNode->value.str.length), sizeof(STRING_DELIM) + sizeof(STRING_DELIM));
+}
+static size_t JSONObjNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode->type == JSONObjType);
+
+    size_t length = sizeof(JSONOBJ_START) + sizeof(JSONOBJ_END);
+    JSONObj_t* jsonObj = &pNode->value.children;
+
+    if (!JSONObjIsEmpty(jsonObj)) {
+        JSONNode_t* current = jsonObj->pFirstChild;
+        while (current != NULL) {
+            length = JSONAddLengths(length, JSONNodeGetLength(current));
+            if (current != jsonObj->pLastChild) {
+                length = JSONAddLengths(length, sizeof(CHILD_SEPARATOR));
+            }
+            current = current->pNextSibling;
+        }
+    }
+    return length;
+}
+static size_t JSONArrayNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode->type == JSONArrayType);
+
+    size_t length = sizeof(JSONARRAY_START) + sizeof(JSONARRAY_END);
+    JSONArray_t* jsonArray = &pNode->value.array;
+
+    if (!JSONArrayIsEmpty(jsonArray)) {
+        JSONNode_t* current = jsonArray->pStart;
+        while (current != NULL) {
+            length = JSONAddLengths(length, JSONNodeGetValueLength(current));
+            if (current != jsonArray->pEnd) {
+                length = JSONAddLengths(length, sizeof(CHILD_SEPARATOR));
+            }
+            current = current->pNextSibling;
+        }
+    }
+    return length;
+}
+static size_t JSONPackedArrayNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(JSONNodeIsPackedArray(pNode));
+    return JSONAddLengths(sizeof(JSONARRAY_START) + sizeof(JSONARRAY_END), JSONPackedArrayGetFormattedLength(pNode->type, pNode->value.packed.pData, pNode->value.packed.count));
+}
+/// @brief Computes the length of a node's value from scratch. Objects and arrays add up the (already known) lengths of their children.
+/// @param pNode The node
+/// @return The length
+static size_t JSONNodeComputeValueLength(JSONNode_t* pNode) {
+    size_t length;
+    switch (pNode->type) {
+        case JSONNullType: {
+            length = 4; // it's always just null
+            break;
+        }
+        case JSONBoolType: {
+            length = JSONBoolNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONIntType: {
+            length = JSONIntNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONFloatType: {
+            length = JSONFloatNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONDoubleType: {
+            length = JSONDoubleNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONStringType: {
+            length = JSONStringNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONObjType: {
+            length = JSONObjNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONArrayType: {
+            length = JSONArrayNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONIntArrayType:
+        case JSONFloatArrayType: {
+            length = JSONPackedArrayNodeGetValueLength(pNode);
+            break;
+        }
+        case JSONRawType: {
+            length = pNode->value.raw.length;
+            break;
+        }
+        default: {
+            length = 0;
+            break;
+        }
+    }
+    return length;
+}
+/// @brief Gets the length of a node's value. It's kept up to date as the tree changes, so this is O(1) even for huge objects and arrays.
+/// @param pNode The node
+/// @return The length, SIZE_MAX if it doesn't fit in a size_t
+size_t JSONNodeGetValueLength(JSONNode_t* pNode) {
+    JsonAssert(pNode != NULL);
+    return pNode->valueLength;
+}
+/// @brief Gets the length of a node (key + ':' + value).
+/// @param pNode The node
+/// @return The length
+size_t JSONNodeGetLength(JSONNode_t* pNode) {
+    return JSONAddLengths(JSONNodeGetPreValLength(pNode), JSONNodeGetValueLength(pNode));
+}
+
+#pragma region BUFFER_UTILS
+/// @brief Initializes an empty output buffer.
+/// @param pCtx The context whose malloc/free/memcpy the buffer uses
+/// @param pBuffer The buffer
+/// @param capacity How many bytes to allocate up front (0 allocates lazily on the first write)
+void JSONCtxBufferInit(JSONContext_t* pCtx, JSONBuffer_t* pBuffer, size_t capacity) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(pBuffer != NULL);
+    pBuffer->pCtx = pCtx;
+    pBuffer->pData = NULL;
+    pBuffer->length = 0;
+    pBuffer->capacity = 0;
+    pBuffer->pSink = NULL;
+    pBuffer->bOwnsData = true;
+    pBuffer->bFailed = false;
+#if JSON_ENABLE_STATS
+    pBuffer->maxDepth = 0;
+    pBuffer->pStats = NULL;
+#endif
+    if (capacity > 0) {
+        pBuffer->pData = (char*)JSONCtxAlloc(pCtx, capacity);
+        JsonAssert(pBuffer->pData != NULL);
+        pBuffer->capacity = capacity;
+    }
+}
+void JSONBufferInit(JSONBuffer_t* pBuffer, size_t capacity) {
+    JSONCtxBufferInit(&defaultContext, pBuffer, capacity);
+}
+/// @brief Initializes a buffer that never grows: once its staging area is full, it gets flushed to a sink instead.
+/// @param pCtx The context whose malloc/free/memcpy the buffer uses
+/// @param pBuffer The buffer
+/// @param pSink Where the bytes go. Must outlive the buffer.
+/// @param pStaging The staging area. If NULL, one of stagingSize bytes gets allocated (and freed by JSONBufferDestroy).
+/// @param stagingSize The size of the staging area, at least JSON_SINK_MIN_CAPACITY
+void JSONCtxBufferInitSink(JSONContext_t* pCtx, JSONBuffer_t* pBuffer, JSONSink_t* pSink, char* pStaging, size_t stagingSize) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pSink != NULL && pSink->write != NULL);
+    JsonAssertMsg(stagingSize >= JSON_SINK_MIN_CAPACITY, "Sink staging area is too small ! It needs room for at least one formatted number.");
+
+    pBuffer->bOwnsData = pStaging == NULL;
+    if (pStaging == NULL) {
+        pStaging = (char*)JSONCtxAlloc(pCtx, stagingSize);
+        JsonAssert(pStaging != NULL);
+    }
+    pBuffer->pCtx = pCtx;
+    pBuffer->pData = pStaging;
+    pBuffer->length = 0;
+    pBuffer->capacity = stagingSize;
+    pBuffer->pSink = pSink;
+    pBuffer->bFailed = false;
+#if JSON_ENABLE_STATS
+    pBuffer->maxDepth = 0;
+    pBuffer->pStats = NULL;
+#endif
+}
+void JSONBufferInitSink(JSONBuffer_t* pBuffer, JSONSink_t* pSink, char* pStaging, size_t stagingSize) {
+    JSONCtxBufferInitSink(&defaultContext, pBuffer, pSink, pStaging, stagingSize);
+}
+/// @brief Frees the memory owned by a buffer. Not needed after JSONBufferDetach. Sink buffers should be flushed first.
+/// @param pBuffer The buffer
+void JSONBufferDestroy(JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    if (pBuffer->pData != NULL && pBuffer->bOwnsData) {
+        JSONCtxRelease(pBuffer->pCtx, pBuffer->pData, pBuffer->capacity);
+    }
+    pBuffer->pData = NULL;
+    pBuffer->length = 0;
+    pBuffer->capacity = 0;
+}
+/// @brief Hands everything staged so far to the buffer's sink. Does nothing for growable buffers.
+/// @param pBuffer The buffer
+/// @return false if the sink has failed at any point, true otherwise
+bool JSONBufferFlush(JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    if (pBuffer->pSink != NULL && pBuffer->length > 0) {
+        // once the sink fails, everything after that is dropped: the output is broken anyway
+        if (!pBuffer->bFailed && !pBuffer->pSink->write(pBuffer->pSink->pUserData, pBuffer->pData, pBuffer->length)) {
+            pBuffer->bFailed = true;
+        }
+        pBuffer->length = 0;
+    }
+    return !pBuffer->bFailed;
+}
+/// @brief Allocates memory for a buffer through its context, like JSONCtxAlloc. With JSON_ENABLE_STATS, it's counted in the buffer's pStats if it has some.
+static char* JSONBufferAllocData(JSONBuffer_t* pBuffer, size_t size) {
+#if JSON_ENABLE_STATS
+    if (pBuffer->pStats != NULL) {
+        char* pData = (char*)pBuffer->pCtx->funcs.malloc(size);
+        if (pData != NULL) {
+            JSONStatsCountAlloc(pBuffer->pStats, size);
+        }
+        return pData;
+    }
+#endif
+    return (char*)JSONCtxAlloc(pBuffer->pCtx, size);
+}
+/// @brief Frees memory from JSONBufferAllocData, counting it the same way.
+static void JSONBufferReleaseData(JSONBuffer_t* pBuffer, char* pData, size_t size) {
+#if JSON_ENABLE_STATS
+    if (pBuffer->pStats != NULL) {
+        pBuffer->pCtx->funcs.free(pData);
+        pBuffer->pStats->liveBytes -= size;
+        return;
+    }
+#endif
+    JSONCtxRelease(pBuffer->pCtx, pData, size);
+}
+/// @brief Makes room for `extra` more bytes (plus a null terminator). Growable buffers double their capacity as many times as needed,
+/// sink buffers flush instead, in which case the room can be smaller than asked if extra is bigger than the staging area.
+/// @return Whether `extra` bytes can now be written in one go. For growable buffers, false means the size doesn't fit in a size_t, and the buffer has failed.
+static bool JSONBufferTryReserve(JSONBuffer_t* pBuffer, size_t extra) {
+    size_t needed = JSONAddLengths(pBuffer->length, JSONAddLengths(extra, 1));
+    if (needed <= pBuffer->capacity) return true;
+
+    if (pBuffer->pSink != NULL) {
+        (void)JSONBufferFlush(pBuffer);
+        return extra < pBuffer->capacity;
+    }
+    if (needed == JSON_LENGTH_OVERFLOW) {
+        pBuffer->bFailed = true;
+        return false;
+    }
+
+    size_t newCapacity = pBuffer->capacity > 0 ? pBuffer->capacity : JSON_DUMP_DEFAULT_CAPACITY;
+    while (newCapacity < needed) {
+        if (newCapacity > SIZE_MAX / 2) {
+            newCapacity = needed; // doubling again would wrap around
+            break;
+        }
+        newCapacity *= 2;
+    }
+
+    JsonAssertMsg(pBuffer->bOwnsData || pBuffer->pData == NULL, "Tried to grow a buffer that doesn't own its memory !");
+    char* pNewData = JSONBufferAllocData(pBuffer, newCapacity);
+    JsonAssert(pNewData != NULL);
+    if (pBuffer->pData != NULL) {
+        (void)pBuffer->pCtx->funcs.memcpy(pNewData, pBuffer->pData, pBuffer->length);
+        JSONBufferReleaseData(pBuffer, pBuffer->pData, pBuffer->capacity);
+    }
+    pBuffer->pData = pNewData;
+    pBuffer->capacity = newCapacity;
+    return true;
+}
+/// @brief Makes sure at least `extra` more bytes (plus a null terminator) fit in the buffer.
+/// For sink buffers, `extra` can't be more than the staging area (minus 1).
+/// @param pBuffer The buffer
+/// @param extra The number of bytes about to be written
+void JSONBufferReserve(JSONBuffer_t* pBuffer, size_t extra) {
+    bool bReserved = JSONBufferTryReserve(pBuffer, extra);
+    JsonAssertMsg(bReserved || pBuffer->pSink == NULL, "Tried to reserve more than a sink buffer's staging area !");
+    (void)bReserved;
+}
+void JSONBufferPutChar(JSONBuffer_t* pBuffer, char c) {
+    if (!JSONBufferTryReserve(pBuffer, 1)) return;
+    pBuffer->pData[pBuffer->length++] = c;
+}
+void JSONBufferWrite(JSONBuffer_t* pBuffer, const char* pData, size_t length) {
+    // sink buffers might not fit everything at once, in which case it goes through one staging area's worth at a time
+    while (!JSONBufferTryReserve(pBuffer, length)) {
+        if (pBuffer->pSink == NULL) return; // too big for a size_t, the buffer has failed
+        size_t chunk = pBuffer->capacity - pBuffer->length - 1;
+        (void)pBuffer->pCtx->funcs.memcpy(pBuffer->pData + pBuffer->length, pData, chunk);
+        pBuffer->length += chunk;
+        pData += chunk;
+        length -= chunk;
+    }
+    (void)pBuffer->pCtx->funcs.memcpy(pBuffer->pData + pBuffer->length, pData, length);
+    pBuffer->length += length;
+}
+/// @brief Null-terminates the buffer and hands its memory over to the caller. The buffer is left empty. Only for growable buffers.
+/// @param pBuffer The buffer
+/// @param pOutLength If not NULL, receives the length of the string (without the null terminator)
+/// @return The string. Must be freed.
+char* JSONBufferDetach(JSONBuffer_t* pBuffer, size_t* pOutLength) {
+    JsonAssertMsg(pBuffer->pSink == NULL, "Tried to detach a sink buffer ! Its bytes have already been handed to the sink.");
+    JSONBufferReserve(pBuffer, 0);
+    pBuffer->pData[pBuffer->length] = '\0';
+
+    char* pData = pBuffer->pData;
+    if (pOutLength != NULL) {
+        *pOutLength = pBuffer->length;
+    }
+    JSONStatsForgetBytes(pBuffer->pCtx, pBuffer->capacity); // the caller frees it now
+    pBuffer->pData = NULL;
+    pBuffer->length = 0;
+    pBuffer->capacity = 0;
+    return pData;
+}
+#pragma endregion
+
+#pragma region VALUE_WRITERS
+// These write single JSON tokens to a buffer. Both the tree dump and JSONWriter_t go through them, so the two always produce the same bytes.
+
+/// @brief Writes a string, escaping whatever needs to be. Clean runs get copied in bulk.
+static void JSONBufferWriteEscaped(JSONBuffer_t* pBuffer, const char* str, size_t length) {
+    char escape[6];
+    size_t i = 0;
+    while (i < length) {
+        size_t runLength = JSONFindEscape(str + i, length - i);
+        JSONBufferWrite(pBuffer, str + i, runLength);
+        i += runLength;
+        if (i == length) break;
+        JSONBufferWrite(pBuffer, escape, JSONFormatEscape(escape, (unsigned char)str[i]));
+        i++;
+    }
+}
+/// @brief Writes a string between quotes. The common case where there's nothing to escape gets copied straight into the buffer.
+static void JSONBufferWriteQuoted(JSONBuffer_t* pBuffer, const char* str, size_t strLength) {
+    size_t cleanLength = JSONFindEscape(str, strLength);
+    if (cleanLength != strLength || !JSONBufferTryReserve(pBuffer, strLength + 2)) {
+        JSONBufferPutChar(pBuffer, STRING_DELIM);
+        JSONBufferWriteEscaped(pBuffer, str, strLength);
+        JSONBufferPutChar(pBuffer, STRING_DELIM);
+        return;
+    }
+
+    char* pOut = pBuffer->pData + pBuffer->length;
+    *pOut++ = STRING_DELIM;
+    (void)pBuffer->pCtx->funcs.memcpy(pOut, str, strLength);
+    pOut += strLength;
+    *pOut = STRING_DELIM;
+    pBuffer->length += strLength + 2;
+}
+/// @brief Writes a key followed by a ':'.
+static void JSONBufferWriteKey(JSONBuffer_t* pBuffer, const char* name, size_t nameLength) {
+    JSONBufferWriteQuoted(pBuffer, name, nameLength);
+    JSONBufferPutChar(pBuffer, KEYVAL_SEPARATOR);
+}
+static void JSONBufferWriteNull(JSONBuffer_t* pBuffer) {
+    JSONBufferWrite(pBuffer, "null", 4);
+}
+static void JSONBufferWriteBool(JSONBuffer_t* pBuffer, bool value) {
+    if (value) {
+        JSONBufferWrite(pBuffer, "true", 4);
+    } else {
+        JSONBufferWrite(pBuffer, "false", 5);
+    }
+}
+/// @brief Whether `extra` bytes (plus a null terminator) fit in the buffer as it is, without growing or flushing it.
+static bool JSONBufferHasRoom(JSONBuffer_t* pBuffer, size_t extra) {
+    return pBuffer->length + extra < pBuffer->capacity;
+}
+// Numbers get formatted straight into the buffer whenever the longest possible one fits, that way every number only gets formatted once.
+// Near the end of the buffer they go through a scratch copy instead, so an exactly-sized buffer never gets regrown for slack it doesn't use.
+static void JSONBufferWriteInt(JSONBuffer_t* pBuffer, int_type value) {
+    if (JSONBufferHasRoom(pBuffer, JSON_INT_MAX_CHARS)) {
+        pBuffer->length += JSONFormatInt(pBuffer->pData + pBuffer->length, value);
+        return;
+    }
+    char scratch[JSON_INT_MAX_CHARS];
+    JSONBufferWrite(pBuffer, scratch, JSONFormatInt(scratch, value));
+}
+static void JSONBufferWriteFloat(JSONBuffer_t* pBuffer, float_type value) {
+    if (JSONBufferHasRoom(pBuffer, JSON_NUMBER_MAX_CHARS)) {
+        pBuffer->length += JSONFormatFloatType(pBuffer->pData + pBuffer->length, value);
+        return;
+    }
+    char scratch[JSON_NUMBER_MAX_CHARS];
+    JSONBufferWrite(pBuffer, scratch, JSONFormatFloatType(scratch, value));
+}
+static void JSONBufferWriteDouble(JSONBuffer_t* pBuffer, double value) {
+    if (JSONBufferHasRoom(pBuffer, JSON_NUMBER_MAX_CHARS)) {
+        pBuffer->length += JSONFormatDouble(pBuffer->pData + pBuffer->length, value);
+        return;
+    }
+    char scratch[JSON_NUMBER_MAX_CHARS];
+    JSONBufferWrite(pBuffer, scratch, JSONFormatDouble(scratch, value));
+}
+/// @brief Writes packed values as an array. Same idea as the single number writers, but the room check is all the loop does between two values.
+static void JSONBufferWritePackedArray(JSONBuffer_t* pBuffer, JSONType_t type, const void* pValues, size_t count) {
+    const size_t maxChars = (type == JSONIntArrayType ? JSON_INT_MAX_CHARS : JSON_NUMBER_MAX_CHARS) + sizeof(CHILD_SEPARATOR);
+    char scratch[JSON_NUMBER_MAX_CHARS + sizeof(CHILD_SEPARATOR)];
+
+    JSONBufferPutChar(pBuffer, JSONARRAY_START);
+    size_t i = 0;
+    while (i < count) {
+        char* pData = pBuffer->pData;
+        size_t length = pBuffer->length;
+        if (type == JSONIntArrayType) {
+            const int_type* pInts = (const int_type*)pValues;
+            for (; i < count && length + maxChars < pBuffer->capacity; i++) {
+                if (i > 0) pData[length++] = CHILD_SEPARATOR;
+                length += JSONFormatInt(pData + length, pInts[i]);
+            }
+        } else {
+            const float_type* pFloats = (const float_type*)pValues;
+            for (; i < count && length + maxChars < pBuffer->capacity; i++) {
+                if (i > 0) pData[length++] = CHILD_SEPARATOR;
+                length += JSONFormatFloatType(pData + length, pFloats[i]);
+            }
+        }
+        pBuffer->length = length;
+        if (i == count) break;
+
+        // the next value might not fit, write it through the scratch copy (which grows or flushes the buffer)
+        size_t scratchLength = 0;
+        if (i > 0) scratch[scratchLength++] = CHILD_SEPARATOR;
+        if (type == JSONIntArrayType) {
+            scratchLength += JSONFormatInt(scratch + scratchLength, ((const int_type*)pValues)[i]);
+        } else {
+            scratchLength += JSONFormatFloatType(scratch + scratchLength, ((const float_type*)pValues)[i]);
+        }
+        JSONBufferWrite(pBuffer, scratch, scratchLength);
+        i++;
+    }
+    JSONBufferPutChar(pBuffer, JSONARRAY_END);
+}
+static void JSONBufferWriteString(JSONBuffer_t* pBuffer, const char* str, size_t strLength) {
+    JSONBufferWriteQuoted(pBuffer, str, strLength);
 }
+#pragma endregion
 
-JSONNode_t* JSONCreateNamedNullNode(const char* name) {
-    JSONValue_t jsonValue = {.i = NULL};
-    return JSONCreateNode(name, JSONNullType, jsonValue);
+static void JSONNodeDumpPreVal(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    if (pNode->pParent == NULL) return;
+    if (pNode->pParent->type != JSONObjType) return;
+
+    if (pNode->pKey != NULL) {
+        JSONBufferWrite(pBuffer, pNode->pKey->pFragment, pNode->pKey->fragmentLength);
+        return;
+    }
+    JSONBufferWriteKey(pBuffer, pNode->name, pNode->pCtx->funcs.strlen(pNode->name));
 }
-JSONNode_t* JSONCreateNamedBoolNode(const char* name, bool value) {
-    JSONValue_t jsonValue = {.b = value};
-    return JSONCreateNode(name, JSONBoolType, jsonValue);
+static void JSONNodeNullValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pNode->type == JSONNullType);
+
+    JSONBufferWriteNull(pBuffer);
 }
-JSONNode_t* JSONCreateNamedIntNode(const char* name, int_type value) {
-    JSONValue_t jsonValue = {.i = value};
-    return JSONCreateNode(name, JSONIntType, jsonValue);
+static void JSONNodeBoolValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pNode->type == JSONBoolType);
+
+    JSONBufferWriteBool(pBuffer, pNode->value.b);
 }
-JSONNode_t* JSONCreateNamedFloatNode(const char* name, float_type value) {
-    JSONValue_t jsonValue = {.f = value};
-    return JSONCreateNode(name, JSONFloatType, jsonValue);
+static void JSONNodeIntValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pNode->type == JSONIntType);
+
+    JSONBufferWriteInt(pBuffer, pNode->value.i);
 }
-JSONNode_t* JSONCreateNamedStrNode(const char* name, const char* value) {
-    JSONValue_t jsonValue = {.str = value};
-    return JSONCreateNode(name, JSONStringType, jsonValue);
+static void JSONNodeFloatValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pNode->type == JSONFloatType);
+
+    JSONBufferWriteFloat(pBuffer, pNode->value.f);
 }
-JSONNode_t* JSONCreateNewNamedObjNode(const char* name) {
-    JSONObj_t* pEmptyChildren = (JSONObj_t*)jsonFuncs.malloc(sizeof(JSONObj_t));
-    (void)jsonFuncs.memset(pEmptyChildren, 0, sizeof(JSONObj_t));
+static void JSONNodeDoubleValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pNode->type == JSONDoubleType);
 
-    JSONValue_t jsonValue = {.pChildren=pEmptyChildren};
-    return JSONCreateNode(name, JSONObjType, jsonValue);
+    JSONBufferWriteDouble(pBuffer, pNode->value.d);
 }
-JSONNode_t* JSONCreateNamedObjNode(const char* name, JSONObj_t* pObj) {
-    JSONValue_t jsonValue = {.pChildren=pObj};
-    return JSONCreateNode(name, JSONObjType, jsonValue);
+static void JSONNodeStringValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pNode->type == JSONStringType);
+
+    JSONBufferWriteString(pBuffer, pNode->value.str.pData, pNode->value.str.length);
 }
-JSONNode_t* JSONCreateNewNamedArrayNode(const char* name) {
-    JSONArray_t* pEmptyArray = (JSONArray_t*)jsonFuncs.malloc(sizeof(JSONArray_t));
-    (void)jsonFuncs.memset(pEmptyArray, 0, sizeof(JSONArray_t));
 
-    JSONValue_t jsonValue = {.pArray=pEmptyArray};
-    return JSONCreateNode(name, JSONArrayType, jsonValue);
+static void JSONNodePackedArrayValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(JSONNodeIsPackedArray(pNode));
+
+    JSONBufferWritePackedArray(pBuffer, pNode->type, pNode->value.packed.pData, pNode->value.packed.count);
 }
-JSONNode_t* JSONCreateNamedArrayNode(const char* name, JSONArray_t* pArray) {
-    JSONValue_t jsonValue = {.pArray=pArray};
-    return JSONCreateNode(name, JSONArrayType, jsonValue);
+
+static void JSONNodeRawValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JsonAssert(pBuffer != NULL);
+    JsonAssert(pNode->type == JSONRawType);
+
+    JSONBufferWrite(pBuffer, pNode->value.raw.pData, pNode->value.raw.length);
 }
 
-JSONNode_t* JSONCreateNullNode() {
-    return JSONCreateNamedNullNode("");
+static void JSONNodeCachedValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer, size_t depth);
+
+/// @brief Dumps the value of a node that can't have children (packed arrays included).
+static void JSONNodeScalarValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    switch (pNode->type) {
+        case JSONNullType: {
+            JSONNodeNullValueDump(pNode, pBuffer);
+            break;
+        }
+        case JSONBoolType: {
+            JSONNodeBoolValueDump(pNode, pBuffer);
+            break;
+        }
+        case JSONIntType: {
+            JSONNodeIntValueDump(pNode, pBuffer);
+            break;
+        }
+        case JSONFloatType: {
+            JSONNodeFloatValueDump(pNode, pBuffer);
+            break;
+        }
+        case JSONDoubleType: {
+            JSONNodeDoubleValueDump(pNode, pBuffer);
+            break;
+        }
+        case JSONStringType: {
+            JSONNodeStringValueDump(pNode, pBuffer);
+            break;
+        }
+        case JSONIntArrayType:
+        case JSONFloatArrayType: {
+            JSONNodePackedArrayValueDump(pNode, pBuffer);
+            break;
+        }
+        case JSONRawType: {
+            JSONNodeRawValueDump(pNode, pBuffer);
+            break;
+        }
+        default: {
+            // if you somehow manage to get a node with an invalid type then something has gone insanely terribly horribly wrong
+            // in which case one could say you deserve however many layers of UB are bound to arise from this,
+            // however since i'm a nice person I put an assert here so you could just end it right there
+            // before whatever fire your computer is on destroys the state of your program even further than it already has
+            JsonAssertMsg(false, "Tried to dump node of unknown type !");
+        }
+    }
 }
-JSONNode_t* JSONCreateBoolNode(bool value) {
-    return JSONCreateNamedBoolNode("", value);
+
+/// @brief Dumps the value of a node and everything under it without recursing: it goes down through first children,
+/// then across through next siblings, and back up through parents, closing brackets on the way, so stack use doesn't depend on depth.
+/// The node itself always gets walked into, its descendants' dump caches get used.
+/// @param pRoot The node to dump
+/// @param pBuffer Where to dump it
+/// @param depth How many objects/arrays pRoot is nested in
+static void JSONNodeDumpTree(JSONNode_t* pRoot, JSONBuffer_t* pBuffer, size_t depth) {
+    const size_t maxDepth = pRoot->pCtx->maxDepth;
+    JSONNode_t* current = pRoot;
+    for (;;) {
+        if (current != pRoot) {
+            JSONNodeDumpPreVal(current, pBuffer);
+        }
+
+        if (JSONNodeCanHaveChildren(current)) {
+            if (depth >= maxDepth) {
+                pBuffer->bFailed = true; // nested too deep
+                return;
+            }
+            bool bObj = current->type == JSONObjType;
+            JSONNode_t* pFirstChild = JSONNodeGetFirstChild(current);
+            if (current != pRoot && current->pDumpCache != NULL) {
+                JSONNodeCachedValueDump(current, pBuffer, depth);
+                if (pBuffer->bFailed) return;
+            } else if (pFirstChild != NULL) {
+                JSONBufferPutChar(pBuffer, bObj ? JSONOBJ_START : JSONARRAY_START);
+                depth++;
+                JSONStatsDepthReached(pBuffer, depth);
+                current = pFirstChild;
+                continue;
+            } else {
+                JSONStatsDepthReached(pBuffer, depth + 1);
+                JSONBufferPutChar(pBuffer, bObj ? JSONOBJ_START : JSONARRAY_START);
+                JSONBufferPutChar(pBuffer, bObj ? JSONOBJ_END : JSONARRAY_END);
+            }
+        } else {
+            if (JSONNodeIsPackedArray(current)) {
+                // packed arrays are one more level of nesting, even if their values aren't nodes
+                if (depth >= maxDepth) {
+                    pBuffer->bFailed = true;
+                    return;
+                }
+                JSONStatsDepthReached(pBuffer, depth + 1);
+            }
+            JSONNodeScalarValueDump(current, pBuffer);
+        }
+
+        // go back up until there's a next sibling to go to, closing whatever gets left
+        while (current != pRoot && current->pNextSibling == NULL) {
+            current = current->pParent;
+            depth--;
+            JSONBufferPutChar(pBuffer, current->type == JSONObjType ? JSONOBJ_END : JSONARRAY_END);
+        }
+        if (current == pRoot) return;
+        JSONBufferPutChar(pBuffer, CHILD_SEPARATOR);
+        current = current->pNextSibling;
+    }
 }
-JSONNode_t* JSONCreateIntNode(int_type value) {
-    return JSONCreateNamedIntNode("", value);
+
+/// @brief Copies a node's cached bytes, refilling the cache first if anything under the node changed since the last dump.
+static void JSONNodeCachedValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer, size_t depth) {
+    JSONBuffer_t* pCache = pNode->pDumpCache;
+    if (pNode->flags & JSON_NODE_FLAG_DIRTY) {
+#if JSON_ENABLE_STATS
+        // on a JSONDumpParallel worker, the refill gets counted in the task's counters instead of racing on the context's
+        pCache->pStats = pBuffer->pStats;
+#endif
+        pCache->length = 0;
+        pCache->bFailed = false;
+        JSONBufferReserve(pCache, pNode->valueLength);
+        JSONNodeDumpTree(pNode, pCache, depth);
+#if JSON_ENABLE_STATS
+        pCache->pStats = NULL;
+        JSONStatsDepthReached(pBuffer, pCache->maxDepth);
+        pCache->maxDepth = 0;
+#endif
+        if (pCache->bFailed) {
+            pBuffer->bFailed = true;
+            return;
+        }
+        JsonAssertMsg(pCache->length == pNode->valueLength, "Node length is out of date ! Values should only be changed through the JSONNodeSet* functions.");
+        pNode->flags &= (uint8_t)~JSON_NODE_FLAG_DIRTY;
+    }
+    JSONBufferWrite(pBuffer, pCache->pData, pCache->length);
 }
-JSONNode_t* JSONCreateFloatNode(float_type value) {
-    return JSONCreateNamedFloatNode("", value);
+/// @param depth How many objects/arrays pNode is nested in
+static void JSONNodeValueDumpAt(JSONNode_t* pNode, JSONBuffer_t* pBuffer, size_t depth) {
+    if (pNode->pDumpCache != NULL) {
+        JSONNodeCachedValueDump(pNode, pBuffer, depth);
+    } else {
+        JSONNodeDumpTree(pNode, pBuffer, depth);
+    }
 }
-JSONNode_t* JSONCreateStrNode(const char* value) {
-    return JSONCreateNamedStrNode("", value);
+/// @brief Dumps the value of a node (and everything under it) into a buffer. If the tree is nested deeper than its context's maxDepth,
+/// the buffer's bFailed gets set and the dump stops there. Same if its length doesn't fit in a size_t, in which case nothing gets written.
+void JSONNodeValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    if (pNode->valueLength == JSON_LENGTH_OVERFLOW) {
+        pBuffer->bFailed = true;
+        return;
+    }
+    JSONNodeValueDumpAt(pNode, pBuffer, 0);
 }
-JSONNode_t* JSONCreateNewObjNode() {
-    return JSONCreateNewNamedObjNode("");
+
+void JSONNodeDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer) {
+    JSONNodeDumpPreVal(pNode, pBuffer);
+    JSONNodeValueDump(pNode, pBuffer);
 }
-JSONNode_t* JSONCreateObjNode(JSONObj_t* pObj) {
-    return JSONCreateNamedObjNode("", pObj);
+
+/// @brief Dumps a JSONNode. The tree already knows its length, so the output is allocated once at the exact size.
+/// @param pRoot The root of the tree to dump (or a single node if that's what you want to dump)
+/// @return The string representation of the JSON node. Must be freed. NULL if the tree is nested deeper than its context's maxDepth,
+/// or if its length doesn't fit in a size_t.
+const char* JSONDump(JSONNode_t* pRoot) {
+    JsonAssert(pRoot != NULL);
+    return JSONDumpWithCapacityHint(pRoot, JSONAddLengths(JSONNodeGetValueLength(pRoot), 1), NULL);
 }
-JSONNode_t* JSONCreateNewArrayNode() {
-    return JSONCreateNewNamedArrayNode("");
+/// @brief Dumps a JSONNode in a single pass, starting with a buffer of the given capacity.
+/// @param pRoot The root of the tree to dump
+/// @param capacityHint How many bytes to allocate up front
+/// @param pOutLength If not NULL, receives the length of the dumped string
+/// @return The string representation of the JSON node. Must be freed. NULL if the tree is nested deeper than its context's maxDepth,
+/// or if its length doesn't fit in a size_t.
+const char* JSONDumpWithCapacityHint(JSONNode_t* pRoot, size_t capacityHint, size_t* pOutLength) {
+    JsonAssert(pRoot != NULL);
+#if JSON_ENABLE_STATS
+    uint64_t start = JSONStatsNow(pRoot->pCtx);
+#endif
+    if (JSONNodeGetValueLength(pRoot) == JSON_LENGTH_OVERFLOW) {
+        capacityHint = 0; // the dump fails right away, don't go allocating a saturated hint
+    }
+
+    JSONBuffer_t buffer;
+    JSONCtxBufferInit(pRoot->pCtx, &buffer, capacityHint);
+#if JSON_ENABLE_STATS
+    uint64_t sized = JSONStatsNow(pRoot->pCtx);
+#endif
+    JSONNodeValueDump(pRoot, &buffer);
+#if JSON_ENABLE_STATS
+    JSONStatsDumpDone(pRoot->pCtx, start, sized, buffer.length, buffer.maxDepth, buffer.bFailed);
+#endif
+    if (buffer.bFailed) {
+        JSONBufferDestroy(&buffer);
+        return NULL;
+    }
+    return (const char*)JSONBufferDetach(&buffer, pOutLength);
 }
-JSONNode_t* JSONCreateArrayNode(JSONArray_t* pArray) {
-    return JSONCreateNamedArrayNode("", pArray);
+/// @brief Dumps a JSONNode into its context's scratch buffer, which is reused from one dump to the next,
+/// so repeatedly dumping trees of similar size doesn't allocate anything.
+/// @param pRoot The root of the tree to dump
+/// @param pOutLength If not NULL, receives the length of the dumped string
+/// @return The string representation of the JSON node. Owned by the context, only valid until the next dump into its scratch buffer.
+/// NULL if the tree is nested deeper than its context's maxDepth, or if its length doesn't fit in a size_t.
+const char* JSONDumpToScratch(JSONNode_t* pRoot, size_t* pOutLength) {
+    JsonAssert(pRoot != NULL);
+
+#if JSON_ENABLE_STATS
+    uint64_t start = JSONStatsNow(pRoot->pCtx);
+#endif
+    JSONBuffer_t* pScratch = &pRoot->pCtx->scratch;
+    pScratch->length = 0;
+    pScratch->bFailed = false;
+    JSONBufferReserve(pScratch, JSONNodeGetValueLength(pRoot));
+#if JSON_ENABLE_STATS
+    pScratch->maxDepth = 0;
+    uint64_t sized = JSONStatsNow(pRoot->pCtx);
+#endif
+    JSONNodeValueDump(pRoot, pScratch);
+#if JSON_ENABLE_STATS
+    JSONStatsDumpDone(pRoot->pCtx, start, sized, pScratch->length, pScratch->maxDepth, pScratch->bFailed);
+#endif
+    if (pScratch->bFailed) return NULL;
+    JSONBufferReserve(pScratch, 0);
+    pScratch->pData[pScratch->length] = '\0';
+    if (pOutLength != NULL) {
+        *pOutLength = pScratch->length;
+    }
+    return pScratch->pData;
+}
+/// @brief Dumps a JSONNode through a fixed-size staging area that gets flushed to a sink whenever it fills up,
+/// so memory use doesn't depend on the size of the document and the first bytes go out before the whole thing is dumped.
+/// @param pRoot The root of the tree to dump
+/// @param pSink Where the bytes go
+/// @param pStaging The staging area. If NULL, one of stagingSize bytes is allocated for the duration of the dump.
+/// @param stagingSize The size of the staging area, at least JSON_SINK_MIN_CAPACITY
+/// @return Whether the sink accepted everything (false too if the tree is nested deeper than its context's maxDepth, or if its length doesn't fit in a size_t)
+bool JSONDumpToSink(JSONNode_t* pRoot, JSONSink_t* pSink, char* pStaging, size_t stagingSize) {
+    JsonAssert(pRoot != NULL);
+#if JSON_ENABLE_STATS
+    uint64_t start = JSONStatsNow(pRoot->pCtx);
+#endif
+
+    JSONBuffer_t buffer;
+    JSONCtxBufferInitSink(pRoot->pCtx, &buffer, pSink, pStaging, stagingSize);
+#if JSON_ENABLE_STATS
+    uint64_t sized = JSONStatsNow(pRoot->pCtx);
+#endif
+    JSONNodeValueDump(pRoot, &buffer);
+    bool bSuccess = JSONBufferFlush(&buffer);
+#if JSON_ENABLE_STATS
+    // the staging area got flushed along the way, but the tree knows how long the whole thing was
+    JSONStatsDumpDone(pRoot->pCtx, start, sized, JSONNodeGetValueLength(pRoot), buffer.maxDepth, !bSuccess);
+#endif
+    JSONBufferDestroy(&buffer);
+    return bSuccess;
+}
+
+#pragma region PARALLEL_DUMP
+#if JSON_ENABLE_THREADS
+// Every node knows its dumped length, so where each subtree lands in the output is known before anything is written.
+// The calling thread walks the top of the tree, writes the brackets, keys and separators of the containers it splits,
+// and cuts everything else into tasks (a single subtree, or a run of small consecutive siblings) that each own a fixed range of the output.
+// Threads then pull tasks off a shared counter and dump them straight into place, so the result is byte-identical to JSONDump.
+
+typedef struct JSONDumpTask {
+    JSONNode_t* pFirst;
+    JSONNode_t* pLast; // a run of siblings, dumped with their keys and the separators between them
+    size_t offset;
+    size_t length;
+    size_t depth; // how many objects/arrays pFirst is nested in
+    bool bValueOnly; // just the value of pFirst (for the root)
+    bool bFailed; // nested deeper than the context's maxDepth
+#if JSON_ENABLE_STATS
+    size_t maxDepth;
+    // what the task allocated refilling dump caches, added to the context's counters after the threads are joined
+    size_t allocCount;
+    size_t liveBytes;
+    size_t peakBytes;
+#endif
+} JSONDumpTask_t;
+typedef struct JSONParallelDump {
+    JSONContext_t* pCtx;
+    char* pOutput;
+    size_t outputCapacity;
+    size_t grainSize;
+    JSONDumpTask_t* pTasks;
+    size_t taskCount;
+    size_t taskCapacity;
+    size_t nextTask;
+    bool bFailed; // set while splitting if the top of the tree is already nested too deep
+#if JSON_ENABLE_STATS
+    size_t maxDepth; // deepest container split
+#endif
+    pthread_mutex_t lock;
+} JSONParallelDump_t;
+
+/// @brief Points a buffer at the output, starting at offset. The output has JSON_NUMBER_MAX_CHARS bytes of slack at the end,
+/// so the worst-case reservations of the number writers never make it grow, and each writer only writes the bytes of its own range.
+static void JSONParallelDumpInitRegion(JSONParallelDump_t* pJob, JSONBuffer_t* pBuffer, size_t offset) {
+    pBuffer->pCtx = pJob->pCtx;
+    pBuffer->pData = pJob->pOutput + offset;
+    pBuffer->length = 0;
+    pBuffer->capacity = pJob->outputCapacity - offset;
+    pBuffer->pSink = NULL;
+    pBuffer->bOwnsData = false;
+    pBuffer->bFailed = false;
+#if JSON_ENABLE_STATS
+    pBuffer->maxDepth = 0;
+    pBuffer->pStats = NULL;
+#endif
+}
+static void JSONParallelDumpAddTask(JSONParallelDump_t* pJob, JSONNode_t* pFirst, JSONNode_t* pLast, size_t offset, size_t length, size_t depth, bool bValueOnly) {
+    if (pJob->taskCount == pJob->taskCapacity) {
+        size_t newCapacity = pJob->taskCapacity > 0 ? pJob->taskCapacity * 2 : 64;
+        JSONDumpTask_t* pNewTasks = (JSONDumpTask_t*)JSONCtxAlloc(pJob->pCtx, newCapacity * sizeof(JSONDumpTask_t));
+        JsonAssert(pNewTasks != NULL);
+        if (pJob->pTasks != NULL) {
+            (void)pJob->pCtx->funcs.memcpy(pNewTasks, pJob->pTasks, pJob->taskCount * sizeof(JSONDumpTask_t));
+            JSONCtxRelease(pJob->pCtx, pJob->pTasks, pJob->taskCapacity * sizeof(JSONDumpTask_t));
+        }
+        pJob->pTasks = pNewTasks;
+        pJob->taskCapacity = newCapacity;
+    }
+    JSONDumpTask_t* pTask = &pJob->pTasks[pJob->taskCount++];
+    pTask->pFirst = pFirst;
+    pTask->pLast = pLast;
+    pTask->offset = offset;
+    pTask->length = length;
+    pTask->depth = depth;
+    pTask->bValueOnly = bValueOnly;
+    pTask->bFailed = false;
+#if JSON_ENABLE_STATS
+    pTask->maxDepth = 0;
+    pTask->allocCount = 0;
+    pTask->liveBytes = 0;
+    pTask->peakBytes = 0;
+#endif
+}
+/// @brief Whether a node gets dumped by a single task instead of being split further. Cached nodes are never split, so their cache gets used (or refilled).
+/// Neither are nodes below JSON_PARALLEL_MAX_SPLIT_DEPTH, which keeps the (recursive) splitting off deep trees: tasks dump iteratively.
+static bool JSONParallelDumpIsLeaf(JSONParallelDump_t* pJob, JSONNode_t* pNode, size_t depth) {
+    return !JSONNodeCanHaveChildren(pNode) || pNode->valueLength <= pJob->grainSize || pNode->pDumpCache != NULL || depth >= JSON_PARALLEL_MAX_SPLIT_DEPTH;
+}
+/// @brief Writes the brackets, keys and separators of a big container, and turns its children into tasks (or splits them further).
+static void JSONParallelDumpSplit(JSONParallelDump_t* pJob, JSONNode_t* pNode, size_t offset, size_t depth) {
+    if (depth >= pJob->pCtx->maxDepth) {
+        pJob->bFailed = true;
+        return;
+    }
+#if JSON_ENABLE_STATS
+    if (depth + 1 > pJob->maxDepth) {
+        pJob->maxDepth = depth + 1;
+    }
+#endif
+    bool bObj = pNode->type == JSONObjType;
+    JSONNode_t* pFirstChild = bObj ? pNode->value.children.pFirstChild : pNode->value.array.pStart;
+    size_t end = offset + pNode->valueLength;
+
+    pJob->pOutput[offset++] = bObj ? JSONOBJ_START : JSONARRAY_START;
+
+    // the run of small siblings being gathered into a single task
+    JSONNode_t* pRunFirst = NULL;
+    JSONNode_t* pRunLast = NULL;
+    size_t runOffset = 0;
+    size_t runLength = 0;
+
+    for (JSONNode_t* current = pFirstChild; current != NULL; current = current->pNextSibling) {
+        size_t childLength = JSONNodeGetLength(current);
+        bool bLeaf = JSONParallelDumpIsLeaf(pJob, current, depth + 1);
+
+        if (bLeaf && pRunFirst != NULL && runLength + sizeof(CHILD_SEPARATOR) + childLength <= pJob->grainSize) {
+            // the separator in front of it goes in the run too
+            pRunLast = current;
+            runLength += sizeof(CHILD_SEPARATOR) + childLength;
+            offset += sizeof(CHILD_SEPARATOR) + childLength;
+            continue;
+        }
+        if (pRunFirst != NULL) {
+            JSONParallelDumpAddTask(pJob, pRunFirst, pRunLast, runOffset, runLength, depth + 1, false);
+            pRunFirst = NULL;
+        }
+        if (current != pFirstChild) {
+            pJob->pOutput[offset++] = CHILD_SEPARATOR;
+        }
+
+        if (bLeaf) {
+            pRunFirst = current;
+            pRunLast = current;
+            runOffset = offset;
+            runLength = childLength;
+            offset += childLength;
+        } else {
+            JSONBuffer_t keyBuffer;
+            JSONParallelDumpInitRegion(pJob, &keyBuffer, offset);
+            JSONNodeDumpPreVal(current, &keyBuffer);
+            offset += keyBuffer.length;
+            JSONParallelDumpSplit(pJob, current, offset, depth + 1);
+            if (pJob->bFailed) return;
+            offset += current->valueLength;
+        }
+    }
+    if (pRunFirst != NULL) {
+        JSONParallelDumpAddTask(pJob, pRunFirst, pRunLast, runOffset, runLength, depth + 1, false);
+    }
+
+    pJob->pOutput[offset++] = bObj ? JSONOBJ_END : JSONARRAY_END;
+    JsonAssertMsg(offset == end, "Node length is out of date ! Values should only be changed through the JSONNodeSet* functions.");
+    (void)end;
+}
+static void JSONParallelDumpRunTask(JSONParallelDump_t* pJob, JSONDumpTask_t* pTask) {
+    JSONBuffer_t buffer;
+    JSONParallelDumpInitRegion(pJob, &buffer, pTask->offset);
+#if JSON_ENABLE_STATS
+    // the context's counters aren't atomic, so the task counts what it allocates (refilling dump caches) on its own
+    JSONStats_t taskStats;
+    (void)pJob->pCtx->funcs.memset(&taskStats, 0, sizeof(JSONStats_t));
+    buffer.pStats = &taskStats;
+#endif
+    if (pTask->bValueOnly) {
+        JSONNodeValueDumpAt(pTask->pFirst, &buffer, pTask->depth);
+    } else {
+        for (JSONNode_t* current = pTask->pFirst; ; current = current->pNextSibling) {
+            if (current != pTask->pFirst) {
+                JSONBufferPutChar(&buffer, CHILD_SEPARATOR);
+            }
+            JSONNodeDumpPreVal(current, &buffer);
+            JSONNodeValueDumpAt(current, &buffer, pTask->depth);
+            if (buffer.bFailed || current == pTask->pLast) break;
+        }
+    }
+#if JSON_ENABLE_STATS
+    pTask->maxDepth = buffer.maxDepth;
+    pTask->allocCount = taskStats.allocCount;
+    pTask->liveBytes = taskStats.liveBytes;
+    pTask->peakBytes = taskStats.peakBytes;
+#endif
+    if (buffer.bFailed) {
+        pTask->bFailed = true; // only this thread touches the task, the caller reads it after joining
+        return;
+    }
+    JsonAssertMsg(buffer.length == pTask->length, "Node length is out of date ! Values should only be changed through the JSONNodeSet* functions.");
+}
+static void* JSONParallelDumpWorker(void* pArg) {
+    JSONParallelDump_t* pJob = (JSONParallelDump_t*)pArg;
+    for (;;) {
+        pthread_mutex_lock(&pJob->lock);
+        size_t taskIndex = pJob->nextTask++;
+        pthread_mutex_unlock(&pJob->lock);
+        if (taskIndex >= pJob->taskCount) break;
+        JSONParallelDumpRunTask(pJob, &pJob->pTasks[taskIndex]);
+    }
+    return NULL;
+}
+/// @brief Dumps a JSONNode using several threads. The output is byte-identical to JSONDump's.
+/// Meant for big trees (think hundreds of MB): small ones, or ones that can't be split, just get dumped on the calling thread.
+/// The tree must not be modified during the dump. Dirty dump caches get refilled by the worker threads, so the context's malloc must be thread-safe if you use them.
+/// With JSON_ENABLE_STATS, each task counts those allocations on its own, and they get added to the context's counters once the threads are done.
+/// @param pRoot The root of the tree to dump
+/// @param threadCount How many threads to use, including the calling one
+/// @param pOutLength If not NULL, receives the length of the dumped string
+/// @return The string representation of the JSON node. Must be freed. NULL if the tree is nested deeper than its context's maxDepth,
+/// or if its length doesn't fit in a size_t.
+const char* JSONDumpParallel(JSONNode_t* pRoot, size_t threadCount, size_t* pOutLength) {
+    JsonAssert(pRoot != NULL);
+
+    size_t length = JSONNodeGetValueLength(pRoot);
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+
+    JSONParallelDump_t job;
+    job.pCtx = pRoot->pCtx;
+    job.grainSize = length / (threadCount * 16);
+    if (job.grainSize < JSON_PARALLEL_MIN_TASK_SIZE) {
+        job.grainSize = JSON_PARALLEL_MIN_TASK_SIZE;
+    }
+    if (threadCount == 1 || length == JSON_LENGTH_OVERFLOW || length < 2 * job.grainSize || JSONParallelDumpIsLeaf(&job, pRoot, 0)) {
+        return JSONDumpWithCapacityHint(pRoot, JSONAddLengths(length, 1), pOutLength);
+    }
+#if JSON_ENABLE_STATS
+    uint64_t start = JSONStatsNow(job.pCtx);
+    job.maxDepth = 0;
+#endif
+
+    job.outputCapacity = JSONAddLengths(length, 1 + JSON_NUMBER_MAX_CHARS);
+    job.pOutput = (char*)JSONCtxAlloc(job.pCtx, job.outputCapacity);
+    JsonAssert(job.pOutput != NULL);
+    job.pTasks = NULL;
+    job.taskCount = 0;
+    job.taskCapacity = 0;
+    job.nextTask = 0;
+    job.bFailed = false;
+    pthread_mutex_init(&job.lock, NULL);
+
+    JSONParallelDumpSplit(&job, pRoot, 0, 0);
+    if (job.bFailed) {
+        job.taskCount = 0; // nothing worth running
+    }
+#if JSON_ENABLE_STATS
+    uint64_t sized = JSONStatsNow(job.pCtx); // splitting is part of getting the output ready
+#endif
+
+    if (threadCount > job.taskCount) {
+        threadCount = job.taskCount;
+    }
+    pthread_t* pThreads = (pthread_t*)JSONCtxAlloc(job.pCtx, threadCount * sizeof(pthread_t));
+    JsonAssert(pThreads != NULL);
+    size_t startedCount = 0;
+    for (size_t i = 1; i < threadCount; i++) {
+        // if a thread can't be started, the ones that could (and this one) just do more of the work
+        if (pthread_create(&pThreads[startedCount], NULL, JSONParallelDumpWorker, &job) == 0) {
+            startedCount++;
+        }
+    }
+    (void)JSONParallelDumpWorker(&job);
+    for (size_t i = 0; i < startedCount; i++) {
+        pthread_join(pThreads[i], NULL);
+    }
+
+    JSONCtxRelease(job.pCtx, pThreads, threadCount * sizeof(pthread_t));
+    for (size_t i = 0; i < job.taskCount; i++) {
+        if (job.pTasks[i].bFailed) {
+            job.bFailed = true;
+        }
+#if JSON_ENABLE_STATS
+        JSONDumpTask_t* pTask = &job.pTasks[i];
+        if (pTask->maxDepth > job.maxDepth) {
+            job.maxDepth = pTask->maxDepth;
+        }
+        // the tasks' peaks are taken as if they had run one after the other
+        JSONStats_t* pStats = &job.pCtx->stats;
+        pStats->allocCount += pTask->allocCount;
+        if (pStats->liveBytes + pTask->peakBytes > pStats->peakBytes) {
+            pStats->peakBytes = pStats->liveBytes + pTask->peakBytes;
+        }
+        pStats->liveBytes += pTask->liveBytes;
+#endif
+    }
+    if (job.pTasks != NULL) {
+        JSONCtxRelease(job.pCtx, job.pTasks, job.taskCapacity * sizeof(JSONDumpTask_t));
+    }
+    pthread_mutex_destroy(&job.lock);
+#if JSON_ENABLE_STATS
+    JSONStatsDumpDone(job.pCtx, start, sized, length, job.maxDepth, job.bFailed);
+#endif
+    if (job.bFailed) {
+        JSONCtxRelease(job.pCtx, job.pOutput, job.outputCapacity);
+        return NULL;
+    }
+
+    job.pOutput[length] = '\0';
+    if (pOutLength != NULL) {
+        *pOutLength = length;
+    }
+    JSONStatsForgetBytes(job.pCtx, job.outputCapacity); // the caller frees it now
+    return job.pOutput;
+}
+#endif
+#pragma endregion
+
+#pragma region SINKS
+#if JSON_ENABLE_STDIO
+static bool JSONSinkFileWrite(void* pUserData, const char* pData, size_t length) {
+    return fwrite(pData, 1, length, (FILE*)pUserData) == length;
+}
+/// @brief Sets up a sink that writes to a FILE*. The file isn't flushed or closed by the sink.
+void JSONSinkInitFile(JSONSink_t* pSink, FILE* pFile) {
+    JsonAssert(pSink != NULL);
+    JsonAssert(pFile != NULL);
+    pSink->write = JSONSinkFileWrite;
+    pSink->pUserData = pFile;
+}
+#endif
+#if JSON_ENABLE_POSIX
+static bool JSONSinkFdWrite(void* pUserData, const char* pData, size_t length) {
+    int fd = (int)(intptr_t)pUserData;
+    while (length > 0) {
+        ssize_t written = write(fd, pData, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        pData += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+/// @brief Sets up a sink that writes to a raw file descriptor (a file, a pipe, a socket...). Partial writes are retried. The fd isn't closed by the sink.
+void JSONSinkInitFd(JSONSink_t* pSink, int fd) {
+    JsonAssert(pSink != NULL);
+    JsonAssert(fd >= 0);
+    pSink->write = JSONSinkFdWrite;
+    pSink->pUserData = (void*)(intptr_t)fd;
+}
+/// @brief Dumps a tree straight into a memory-mapped file: the file gets sized to the tree's (already known) length,
+/// and the JSON is written in place, so there's no intermediate heap buffer and no copy through write().
+/// @param pSuccess Receives whether the dump worked (only if the file could be mapped)
+/// @return Whether the file could be mapped, or failed for a reason that writing it some other way wouldn't get around (like a full disk).
+/// If not, nothing was written, but the file may have been resized.
+static bool JSONDumpToMappedFd(JSONNode_t* pRoot, int fd, size_t length, bool* pSuccess) {
+    if (length == JSON_LENGTH_OVERFLOW) return false; // the sink path fails it without resizing the file
+#if JSON_ENABLE_STATS
+    uint64_t start = JSONStatsNow(pRoot->pCtx);
+#endif
+    // room for the null terminator and the number writers' worst-case reservations, truncated away afterwards
+    size_t mappedLength = JSONAddLengths(length, 1 + JSON_NUMBER_MAX_CHARS);
+    if ((off_t)mappedLength < 0 || (size_t)(off_t)mappedLength != mappedLength) return false;
+    // allocate the blocks up front (not just a sparse size), so a full disk fails here instead of raising SIGBUS halfway through the dump
+    int error = posix_fallocate(fd, 0, (off_t)mappedLength);
+    if (error == EOPNOTSUPP || error == EINVAL || error == ENODEV) return false; // the file system can't do it, write() may still work
+    if (error != 0) {
+        // out of space (or quota, or I/O errors): write() would only get partway through, so don't fall back to it
+        *pSuccess = false;
+#if JSON_ENABLE_STATS
+        JSONStatsDumpDone(pRoot->pCtx, start, start, length, 0, true);
+#endif
+        return true;
+    }
+
+    void* pMapped = mmap(NULL, mappedLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pMapped == MAP_FAILED) return false;
+
+    JSONBuffer_t buffer;
+    buffer.pCtx = pRoot->pCtx;
+    buffer.pData = (char*)pMapped;
+    buffer.length = 0;
+    buffer.capacity = mappedLength;
+    buffer.pSink = NULL;
+    buffer.bOwnsData = false;
+    buffer.bFailed = false;
+#if JSON_ENABLE_STATS
+    buffer.maxDepth = 0;
+    buffer.pStats = NULL;
+    uint64_t sized = JSONStatsNow(pRoot->pCtx);
+#endif
+    JSONNodeValueDump(pRoot, &buffer);
+    bool bSuccess = !buffer.bFailed;
+    if (bSuccess) {
+        JsonAssertMsg(buffer.length == length, "Node length is out of date ! Values should only be changed through the JSONNodeSet* functions.");
+    }
+
+    bSuccess = munmap(pMapped, mappedLength) == 0 && bSuccess;
+    // a failed dump leaves an empty file rather than a truncated document
+    *pSuccess = ftruncate(fd, bSuccess ? (off_t)length : 0) == 0 && bSuccess;
+#if JSON_ENABLE_STATS
+    JSONStatsDumpDone(pRoot->pCtx, start, sized, length, buffer.maxDepth, !*pSuccess);
+#endif
+    return true;
+}
+/// @brief Dumps a JSONNode to a file, creating or truncating it. The file is sized up front and mapped into memory, and the JSON gets dumped directly into it.
+/// Where that isn't possible (the path is a pipe or a device, or it can't be mapped), it falls back to JSONDumpToSink with JSON_FILE_CHUNK_SIZE-byte writes.
+/// Either way, the document never has to be in the heap. A regular file that the dump fails on (e.g. out of space) is left empty, not truncated halfway.
+/// @param pRoot The root of the tree to dump
+/// @param path The path of the file
+/// @return Whether the whole document was written (false too if the tree is nested deeper than its context's maxDepth)
+bool JSONDumpToFile(JSONNode_t* pRoot, const char* path) {
+    JsonAssert(pRoot != NULL);
+    JsonAssert(path != NULL);
+
+    int fd;
+    do {
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) return false;
+
+    struct stat fileStat;
+    bool bRegular = fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+    bool bSuccess = false;
+    if (!bRegular || !JSONDumpToMappedFd(pRoot, fd, JSONNodeGetValueLength(pRoot), &bSuccess)) {
+        // nothing was written, but the file may have been sized for the mapping
+        if (!bRegular || ftruncate(fd, 0) == 0) {
+            JSONSink_t sink;
+            JSONSinkInitFd(&sink, fd);
+            bSuccess = JSONDumpToSink(pRoot, &sink, NULL, JSON_FILE_CHUNK_SIZE);
+        }
+    }
+    if (!bSuccess && bRegular) {
+        // an empty file rather than a truncated document, whichever way it was written. The dump failed either way.
+        int truncateResult = ftruncate(fd, 0);
+        (void)truncateResult;
+    }
+
+    bSuccess = close(fd) == 0 && bSuccess;
+    return bSuccess;
+}
+#endif
+#pragma endregion
+
+#pragma region WRITER
+// Per-nesting-level state bits of a JSONWriter_t
+#define JSON_WRITER_IN_OBJ 0x1       // the container is an object (an array otherwise)
+#define JSON_WRITER_HAS_ELEMENTS 0x2 // the next key/element needs a CHILD_SEPARATOR in front of it
+#define JSON_WRITER_AFTER_KEY 0x4    // a key was written, its value comes next
+
+/// @brief Initializes a streaming writer. Nothing gets allocated besides what the buffer itself needs.
+/// @param pWriter The writer
+/// @param pBuffer The buffer the JSON gets written to
+void JSONWriterInit(JSONWriter_t* pWriter, JSONBuffer_t* pBuffer) {
+    JsonAssert(pWriter != NULL);
+    JsonAssert(pBuffer != NULL);
+    pWriter->pBuffer = pBuffer;
+    pWriter->depth = 0;
+    pWriter->bComplete = false;
+    pWriter->bFailed = false;
+}
+/// @brief Whether a whole top-level value has been written (every container that was begun has also been ended).
+/// Always false once the writer has failed.
+bool JSONWriterIsComplete(JSONWriter_t* pWriter) {
+    JsonAssert(pWriter != NULL);
+    return pWriter->bComplete && !pWriter->bFailed;
+}
+/// @brief Puts the writer in its failed state: the output is broken, so every call after this one does nothing.
+/// The buffer is marked failed too, so a sink doesn't get sent the truncated JSON.
+static void JSONWriterFail(JSONWriter_t* pWriter) {
+    pWriter->bFailed = true;
+    pWriter->pBuffer->bFailed = true;
+}
+/// @brief Does the bookkeeping needed before any value: separators, and making sure a value is allowed here.
+/// @return false if the writer has failed, in which case the value must not be written
+static bool JSONWriterBeforeValue(JSONWriter_t* pWriter) {
+    JsonAssert(pWriter != NULL);
+    if (pWriter->bFailed) return false;
+    JsonAssertMsg(!pWriter->bComplete, "Tried to write a value after the top-level value was already complete !");
+    if (pWriter->bComplete) {
+        JSONWriterFail(pWriter);
+        return false;
+    }
+    if (pWriter->depth == 0) return true;
+
+    uint8_t* pState = &pWriter->stack[pWriter->depth - 1];
+    if (*pState & JSON_WRITER_IN_OBJ) {
+        JsonAssertMsg(*pState & JSON_WRITER_AFTER_KEY, "Tried to write a value in an object without writing its key first !");
+        if (!(*pState & JSON_WRITER_AFTER_KEY)) {
+            JSONWriterFail(pWriter);
+            return false;
+        }
+        *pState &= (uint8_t)~JSON_WRITER_AFTER_KEY;
+    } else {
+        if (*pState & JSON_WRITER_HAS_ELEMENTS) {
+            JSONBufferPutChar(pWriter->pBuffer, CHILD_SEPARATOR);
+        }
+        *pState |= JSON_WRITER_HAS_ELEMENTS;
+    }
+    return true;
+}
+static void JSONWriterAfterValue(JSONWriter_t* pWriter) {
+    if (pWriter->depth == 0) {
+        pWriter->bComplete = true;
+    }
+}
+static void JSONWriterBeginContainer(JSONWriter_t* pWriter, uint8_t state, char token) {
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    if (pWriter->depth >= JSON_WRITER_MAX_DEPTH) {
+        JSONWriterFail(pWriter); // nested too deep, like a dump past the context's maxDepth. Raise JSON_WRITER_MAX_DEPTH if that's intended.
+        return;
+    }
+
+    pWriter->stack[pWriter->depth++] = state;
+    JSONBufferPutChar(pWriter->pBuffer, token);
+}
+static void JSONWriterEndContainer(JSONWriter_t* pWriter, bool bObj, char token) {
+    JsonAssert(pWriter != NULL);
+    if (pWriter->bFailed) return;
+    JsonAssertMsg(pWriter->depth > 0, "Tried to end a container that was never begun !");
+    if (pWriter->depth == 0) {
+        JSONWriterFail(pWriter);
+        return;
+    }
+
+    uint8_t state = pWriter->stack[pWriter->depth - 1];
+    JsonAssertMsg(((state & JSON_WRITER_IN_OBJ) != 0) == bObj, "Tried to end a different kind of container than the one that was begun !");
+    JsonAssertMsg(!(state & JSON_WRITER_AFTER_KEY), "Tried to end an object right after a key, without its value !");
+    if (((state & JSON_WRITER_IN_OBJ) != 0) != bObj || (state & JSON_WRITER_AFTER_KEY)) {
+        JSONWriterFail(pWriter);
+        return;
+    }
+
+    pWriter->depth--;
+    JSONBufferPutChar(pWriter->pBuffer, token);
+    JSONWriterAfterValue(pWriter);
 }
 
-void JSONNodeAddNamedNullNode(JSONNode_t* pParent, const char* name) {
-    JSONNode_t* pNewNode = JSONCreateNamedNullNode(name);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterBeginObject(JSONWriter_t* pWriter) {
+    JSONWriterBeginContainer(pWriter, JSON_WRITER_IN_OBJ, JSONOBJ_START);
 }
-void JSONNodeAddNamedBoolNode(JSONNode_t* pParent, const char* name, bool value) {
-    JSONNode_t* pNewNode = JSONCreateNamedBoolNode(name, value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterEndObject(JSONWriter_t* pWriter) {
+    JSONWriterEndContainer(pWriter, true, JSONOBJ_END);
 }
-void JSONNodeAddNamedIntNode(JSONNode_t* pParent, const char* name, int_type value) {
-    JSONNode_t* pNewNode = JSONCreateNamedIntNode(name, value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterBeginArray(JSONWriter_t* pWriter) {
+    JSONWriterBeginContainer(pWriter, 0, JSONARRAY_START);
 }
-void JSONNodeAddNamedFloatNode(JSONNode_t* pParent, const char* name, float_type value) {
-    JSONNode_t* pNewNode = JSONCreateNamedFloatNode(name, value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterEndArray(JSONWriter_t* pWriter) {
+    JSONWriterEndContainer(pWriter, false, JSONARRAY_END);
 }
-void JSONNodeAddNamedStringNode(JSONNode_t* pParent, const char* name, const char* value) {
-    JSONNode_t* pNewNode = JSONCreateNamedStrNode(name, value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+/// @brief Writes the key of the next value in the current object.
+/// @param pWriter The writer
+/// @param key The key
+void JSONWriterKey(JSONWriter_t* pWriter, const char* key) {
+    JsonAssert(pWriter != NULL);
+    JsonAssert(key != NULL);
+    if (pWriter->bFailed) return;
+    JsonAssertMsg(pWriter->depth > 0 && (pWriter->stack[pWriter->depth - 1] & JSON_WRITER_IN_OBJ), "Tried to write a key outside of an object !");
+    if (pWriter->depth == 0 || !(pWriter->stack[pWriter->depth - 1] & JSON_WRITER_IN_OBJ)) {
+        JSONWriterFail(pWriter);
+        return;
+    }
+
+    uint8_t* pState = &pWriter->stack[pWriter->depth - 1];
+    JsonAssertMsg(!(*pState & JSON_WRITER_AFTER_KEY), "Tried to write two keys in a row !");
+    if (*pState & JSON_WRITER_AFTER_KEY) {
+        JSONWriterFail(pWriter);
+        return;
+    }
+    if (*pState & JSON_WRITER_HAS_ELEMENTS) {
+        JSONBufferPutChar(pWriter->pBuffer, CHILD_SEPARATOR);
+    }
+    *pState |= JSON_WRITER_HAS_ELEMENTS | JSON_WRITER_AFTER_KEY;
+    JSONBufferWriteKey(pWriter->pBuffer, key, pWriter->pBuffer->pCtx->funcs.strlen(key));
 }
-void JSONNodeAddNewNamedObjNode(JSONNode_t* pParent, const char* name) {
-    JSONNode_t* pNewNode = JSONCreateNewNamedObjNode(name);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterNull(JSONWriter_t* pWriter) {
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONBufferWriteNull(pWriter->pBuffer);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddNamedObjNode(JSONNode_t* pParent, const char* name, JSONObj_t* pObj) {
-    JSONNode_t* pNewNode = JSONCreateNamedObjNode(name, pObj);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterBool(JSONWriter_t* pWriter, bool value) {
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONBufferWriteBool(pWriter->pBuffer, value);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddNewNamedArrayNode(JSONNode_t* pParent, const char* name) {
-    JSONNode_t* pNewNode = JSONCreateNewNamedArrayNode(name);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterInt(JSONWriter_t* pWriter, int_type value) {
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONBufferWriteInt(pWriter->pBuffer, value);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddNamedArrayNode(JSONNode_t* pParent, const char* name, JSONArray_t* pArray) {
-    JSONNode_t* pNewNode = JSONCreateNamedArrayNode(name, pArray);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterFloat(JSONWriter_t* pWriter, float_type value) {
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONBufferWriteFloat(pWriter->pBuffer, value);
+    JSONWriterAfterValue(pWriter);
 }
-
-void JSONNodeAddNullNode(JSONNode_t* pParent) {
-    JSONNode_t* pNewNode = JSONCreateNullNode();
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterDouble(JSONWriter_t* pWriter, double value) {
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONBufferWriteDouble(pWriter->pBuffer, value);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddBoolNode(JSONNode_t* pParent, bool value) {
-    JSONNode_t* pNewNode = JSONCreateBoolNode(value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+void JSONWriterString(JSONWriter_t* pWriter, const char* value) {
+    JsonAssert(value != NULL);
+    JSONWriterStringWithLength(pWriter, value, pWriter->pBuffer->pCtx->funcs.strlen(value));
 }
-void JSONNodeAddIntNode(JSONNode_t* pParent, int_type value) {
-    JSONNode_t* pNewNode = JSONCreateIntNode(value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+/// @brief Writes a string whose length is already known. It doesn't have to be null-terminated.
+void JSONWriterStringWithLength(JSONWriter_t* pWriter, const char* value, size_t length) {
+    JsonAssert(value != NULL || length == 0);
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONBufferWriteString(pWriter->pBuffer, value, length);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddFloatNode(JSONNode_t* pParent, float_type value) {
-    JSONNode_t* pNewNode = JSONCreateFloatNode(value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+/// @brief Writes already serialized JSON as the next value, as is.
+/// @param json A single JSON value. Checked with JSONValidate if JSON_VALIDATE_RAW is on.
+/// @param length Its length
+void JSONWriterRaw(JSONWriter_t* pWriter, const char* json, size_t length) {
+    JSONRawMustBeValid(json, length);
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONBufferWrite(pWriter->pBuffer, json, length);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddStringNode(JSONNode_t* pParent, const char* value) {
-    JSONNode_t* pNewNode = JSONCreateStrNode(value);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+/// @brief Hands everything written so far to the buffer's sink, if it has one. Call it once you're done writing.
+/// @return false if the sink has failed at any point, or if the writer has (nested deeper than JSON_WRITER_MAX_DEPTH, or ended more containers than it began)
+bool JSONWriterFlush(JSONWriter_t* pWriter) {
+    JsonAssert(pWriter != NULL);
+    return JSONBufferFlush(pWriter->pBuffer) && !pWriter->bFailed;
 }
-void JSONNodeAddNewObjNode(JSONNode_t* pParent) {
-    JSONNode_t* pNewNode = JSONCreateNewObjNode();
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+/// @brief Writes a whole JSONNode (and everything under it) as the next value.
+void JSONWriterNode(JSONWriter_t* pWriter, JSONNode_t* pNode) {
+    JsonAssert(pNode != NULL);
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONNodeValueDump(pNode, pWriter->pBuffer);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddObjNode(JSONNode_t* pParent, JSONObj_t* pObj) {
-    JSONNode_t* pNewNode = JSONCreateObjNode(pObj);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+/// @brief Renders a record from a template (see JSONTemplateRender) as the next value.
+void JSONWriterTemplate(JSONWriter_t* pWriter, const JSONTemplate_t* pTemplate, const JSONValue_t* pValues) {
+    if (!JSONWriterBeforeValue(pWriter)) return;
+    JSONTemplateRender(pTemplate, pValues, pWriter->pBuffer);
+    JSONWriterAfterValue(pWriter);
 }
-void JSONNodeAddNewArrayNode(JSONNode_t* pParent) {
-    JSONNode_t* pNewNode = JSONCreateNewArrayNode();
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+#pragma endregion
+
+#pragma region TEMPLATES
+// A template is the dump of a tree with holes in it: the static bytes of every segment back to back in one buffer,
+// and for each value slot, where in those bytes it goes and what type of value it takes.
+
+/// @brief A value slot: the static bytes before it end at offset, then comes a value of the given type.
+struct JSONTemplateSlot {
+    size_t offset;
+    JSONType_t type;
+};
+// Number of slots a template starts with, doubled whenever it runs out
+#define JSON_TEMPLATE_MIN_SLOTS 16
+
+static bool JSONTemplateIsSlotType(JSONType_t type) {
+    return type == JSONBoolType || type == JSONIntType || type == JSONFloatType || type == JSONDoubleType || type == JSONStringType;
 }
-void JSONNodeAddArrayNode(JSONNode_t* pParent, JSONArray_t* pArray) {
-    JSONNode_t* pNewNode = JSONCreateArrayNode(pArray);
-    JSONNodeAdoptChildNode(pParent, pNewNode);
+static void JSONTemplateAddSlot(JSONTemplate_t* pTemplate, JSONType_t type) {
+    JSONContext_t* pCtx = pTemplate->pCtx;
+    if (pTemplate->slotCount == pTemplate->slotCapacity) {
+        size_t newCapacity = pTemplate->slotCapacity > 0 ? pTemplate->slotCapacity * 2 : JSON_TEMPLATE_MIN_SLOTS;
+        struct JSONTemplateSlot* pNewSlots = (struct JSONTemplateSlot*)JSONCtxAlloc(pCtx, newCapacity * sizeof(struct JSONTemplateSlot));
+        JsonAssert(pNewSlots != NULL);
+        if (pTemplate->pSlots != NULL) {
+            (void)pCtx->funcs.memcpy(pNewSlots, pTemplate->pSlots, pTemplate->slotCount * sizeof(struct JSONTemplateSlot));
+            JSONCtxRelease(pCtx, pTemplate->pSlots, pTemplate->slotCapacity * sizeof(struct JSONTemplateSlot));
+        }
+        pTemplate->pSlots = pNewSlots;
+        pTemplate->slotCapacity = newCapacity;
+    }
+    struct JSONTemplateSlot* pSlot = &pTemplate->pSlots[pTemplate->slotCount++];
+    pSlot->offset = pTemplate->staticBytes.length;
+    pSlot->type = type;
 }
+/// @brief Compiles the shape of a tree into a template, for rendering many records that only differ in their values.
+/// Every bool, int, float, double and string value in the tree becomes a slot, numbered in the order they get dumped in, and keeps its type.
+/// Everything else (braces, keys, separators, and null, raw and packed array values) becomes static bytes,
+/// so a raw node is the way to bake a constant value into the template. The tree doesn't get referenced afterwards.
+/// @param pTemplate The template
+/// @param pRoot The root of the tree. Walked without recursing, like a dump.
+/// @return false if the tree is nested deeper than its context's maxDepth, in which case there's nothing to destroy
+bool JSONTemplateCompile(JSONTemplate_t* pTemplate, JSONNode_t* pRoot) {
+    JsonAssert(pTemplate != NULL);
+    JsonAssert(pRoot != NULL);
 
-// for these i'm not using int_type because i chose to adhere to libc functions' return types instead (i.e. sizeof and strlen are size_t, snprintf returns int)
+    JSONContext_t* pCtx = pRoot->pCtx;
+    pTemplate->pCtx = pCtx;
+    JSONCtxBufferInit(pCtx, &pTemplate->staticBytes, 0);
+    pTemplate->pSlots = NULL;
+    pTemplate->slotCount = 0;
+    pTemplate->slotCapacity = 0;
 
-/// @brief Gets the length of a node's key followed by a ':'.
-/// @param pNode The node
-/// @return The length
-size_t JSONNodeGetPreValLength(JSONNode_t* pNode) {
-    if (pNode->pParent != NULL) {
-        if (pNode->pParent->type == JSONObjType) {
-            return sizeof(STRING_DELIM) + jsonFuncs.strlen(pNode->name) + sizeof(STRING_DELIM) + sizeof(KEYVAL_SEPARATOR);
+    JSONBuffer_t* pBuffer = &pTemplate->staticBytes;
+    const size_t maxDepth = pCtx->maxDepth;
+    size_t depth = 0;
+    JSONNode_t* current = pRoot;
+    for (;;) {
+        if (current != pRoot) {
+            JSONNodeDumpPreVal(current, pBuffer);
+        }
+
+        if (JSONNodeCanHaveChildren(current)) {
+            if (depth >= maxDepth) {
+                JSONTemplateDestroy(pTemplate);
+                return false;
+            }
+            bool bObj = current->type == JSONObjType;
+            JSONNode_t* pFirstChild = JSONNodeGetFirstChild(current);
+            JSONBufferPutChar(pBuffer, bObj ? JSONOBJ_START : JSONARRAY_START);
+            if (pFirstChild != NULL) {
+                depth++;
+                current = pFirstChild;
+                continue;
+            }
+            JSONBufferPutChar(pBuffer, bObj ? JSONOBJ_END : JSONARRAY_END);
+        } else if (JSONTemplateIsSlotType(current->type)) {
+            JSONTemplateAddSlot(pTemplate, current->type);
+        } else {
+            if (JSONNodeIsPackedArray(current) && depth >= maxDepth) {
+                JSONTemplateDestroy(pTemplate);
+                return false;
+            }
+            JSONNodeScalarValueDump(current, pBuffer);
+        }
+
+        while (current != pRoot && current->pNextSibling == NULL) {
+            current = current->pParent;
+            depth--;
+            JSONBufferPutChar(pBuffer, current->type == JSONObjType ? JSONOBJ_END : JSONARRAY_END);
         }
+        if (current == pRoot) return true;
+        JSONBufferPutChar(pBuffer, CHILD_SEPARATOR);
+        current = current->pNextSibling;
     }
-    return 0;
-}
-static size_t JSONBoolNodeGetValueLength(JSONNode_t* pNode) {
-    JsonAssert(pNode->type == JSONBoolType);
-    return jsonFuncs.strlen(pNode->value.b == 1 ? "true" : "false");
 }
-static size_t JSONIntNodeGetValueLength(JSONNode_t* pNode) {
-    JsonAssert(pNode->type == JSONIntType);
-    int length = jsonFuncs.snprintf(NULL, 0, "%d", pNode->value.i);
-    JsonAssert(length >= 0);
-    return (size_t)length;
+/// @brief Frees the memory owned by a template.
+void JSONTemplateDestroy(JSONTemplate_t* pTemplate) {
+    JsonAssert(pTemplate != NULL);
+    JSONBufferDestroy(&pTemplate->staticBytes);
+    if (pTemplate->pSlots != NULL) {
+        JSONCtxRelease(pTemplate->pCtx, pTemplate->pSlots, pTemplate->slotCapacity * sizeof(struct JSONTemplateSlot));
+    }
+    pTemplate->pSlots = NULL;
+    pTemplate->slotCount = 0;
+    pTemplate->slotCapacity = 0;
 }
-static size_t JSONFloatNodeGetValueLength(JSONNode_t* pNode) {
-    JsonAssert(pNode->type == JSONFloatType);
-    int length = jsonFuncs.snprintf(NULL, 0, "%g", pNode->value.f);
-    JsonAssert(length >= 0);
-    return (size_t)length;
+/// @brief How many values a record of this template takes.
+size_t JSONTemplateGetSlotCount(const JSONTemplate_t* pTemplate) {
+    JsonAssert(pTemplate != NULL);
+    return pTemplate->slotCount;
 }
-static size_t JSONStringNodeGetValueLength(JSONNode_t* pNode) {
-    JsonAssert(pNode->type == JSONStringType);
-    return sizeof(STRING_DELIM) + jsonFuncs.strlen(pNode->value.str) + sizeof(STRING_DELIM);
+/// @brief The type of value a slot takes, i.e. which member of its JSONValue_t gets read.
+JSONType_t JSONTemplateGetSlotType(const JSONTemplate_t* pTemplate, size_t slot) {
+    JsonAssert(pTemplate != NULL);
+    JsonAssertMsg(slot < pTemplate->slotCount, "Template slot out of range.");
+    return pTemplate->pSlots[slot].type;
 }
-static size_t JSONObjNodeGetValueLength(JSONNode_t* pNode) {
-    JsonAssert(pNode->type == JSONObjType);
+/// @brief Renders one record: the template's static bytes with the given values in its slots. Produces the same bytes as dumping
+/// the tree it was compiled from with those values in it, but without a tree: it's copies of the static segments plus formatting the values.
+/// @param pTemplate The template
+/// @param pValues One value per slot, in order. Each slot reads the member of its type: b, i, f, d, or str (pData and length, escaped as needed).
+/// @param pBuffer Where the record goes. It gets appended to the buffer, so many records can be rendered back to back.
+void JSONTemplateRender(const JSONTemplate_t* pTemplate, const JSONValue_t* pValues, JSONBuffer_t* pBuffer) {
+    JsonAssert(pTemplate != NULL);
+    JsonAssert(pValues != NULL || pTemplate->slotCount == 0);
+    JsonAssert(pBuffer != NULL);
 
-    size_t length = sizeof(JSONOBJ_START) + sizeof(JSONOBJ_END);
-    JSONObj_t* jsonObj = pNode->value.pChildren;
+    const char* pStatic = pTemplate->staticBytes.pData;
+    size_t offset = 0;
+    // only a hint: sink buffers can't always make that much room, and strings can make the record longer anyway
+    (void)JSONBufferTryReserve(pBuffer, pTemplate->staticBytes.length);
+    for (size_t i = 0; i < pTemplate->slotCount; i++) {
+        const struct JSONTemplateSlot* pSlot = &pTemplate->pSlots[i];
+        if (pSlot->offset > offset) {
+            JSONBufferWrite(pBuffer, pStatic + offset, pSlot->offset - offset);
+            offset = pSlot->offset;
+        }
 
-    if (!JSONObjIsEmpty(jsonObj)) {
-        JSONNode_t* current = jsonObj->pFirstChild;
-        while (current != NULL) {
-            length += JSONNodeGetLength(current);
-            if (current != jsonObj->pLastChild) {
-                length += sizeof(CHILD_SEPARATOR);
+        const JSONValue_t* pValue = &pValues[i];
+        switch (pSlot->type) {
+            case JSONBoolType: JSONBufferWriteBool(pBuffer, pValue->b); break;
+            case JSONIntType: JSONBufferWriteInt(pBuffer, pValue->i); break;
+            case JSONFloatType: JSONBufferWriteFloat(pBuffer, pValue->f); break;
+            case JSONDoubleType: JSONBufferWriteDouble(pBuffer, pValue->d); break;
+            default: {
+                JsonAssert(pValue->str.pData != NULL || pValue->str.length == 0);
+                JSONBufferWriteString(pBuffer, pValue->str.pData, pValue->str.length);
+                break;
             }
-            current = current->pNextSibling;
         }
     }
-    return length;
+    if (pTemplate->staticBytes.length > offset) {
+        JSONBufferWrite(pBuffer, pStatic + offset, pTemplate->staticBytes.length - offset);
+    }
 }
-static size_t JSONArrayNodeGetValueLength(JSONNode_t* pNode) {
-    JsonAssert(pNode->type == JSONArrayType);
+#pragma endregion
 
-    size_t length = sizeof(JSONARRAY_START) + sizeof(JSONARRAY_END);
-    JSONArray_t* jsonArray = pNode->value.pArray;
+#pragma region PARSER
+// Numbers with at most this many significant digits and a power of 10 within JSON_PARSE_MAX_EXACT_POW10 convert exactly with one multiply or divide
+#define JSON_PARSE_MAX_EXACT_MANTISSA ((uint64_t)1 << 53)
+#define JSON_PARSE_MAX_EXACT_POW10 22
+// Longest number that gets handed to jsonFuncs.strtod (longer ones are scaled without it)
+#define JSON_PARSE_MAX_STRTOD_CHARS 64
 
-    if (!JSONArrayIsEmpty(jsonArray)) {
-        JSONNode_t* current = jsonArray->pStart;
-        while (current != NULL) {
-            length += JSONNodeGetValueLength(current);
-            if (current != jsonArray->pEnd) {
-                length += sizeof(CHILD_SEPARATOR);
-            }
-            current = current->pNextSibling;
-        }
+static const double jsonDoublePowersOf10[JSON_PARSE_MAX_EXACT_POW10 + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+typedef struct JSONParser {
+    JSONContext_t* pCtx;
+    char* json;
+    size_t length;
+    size_t i; // where parsing is at
+    const char* error; // why it stopped, NULL while it's going fine
+} JSONParser_t;
+
+static bool JSONParserFail(JSONParser_t* pParser, const char* error) {
+    pParser->error = error;
+    return false;
+}
+static unsigned int JSONHexDigitValue(char c) {
+    if (c >= '0' && c <= '9') return (unsigned int)(c - '0');
+    if (c >= 'a' && c <= 'f') return (unsigned int)(c - 'a' + 10);
+    return (unsigned int)(c - 'A' + 10);
+}
+/// @brief Reads the 4 hex digits of a \u escape starting at i.
+static bool JSONParserHex4(JSONParser_t* pParser, size_t i, uint32_t* pOut) {
+    if (pParser->length - i < 4) return false;
+    uint32_t value = 0;
+    for (size_t k = 0; k < 4; k++) {
+        if (!JSONIsHexDigit(pParser->json[i + k])) return false;
+        value = (value << 4) | JSONHexDigitValue(pParser->json[i + k]);
     }
-    return length;
+    *pOut = value;
+    return true;
 }
-/// @brief Gets the length of a node's value, recursing over JSONObjs and JSONArrays.
-/// @param pNode The node
-/// @return The length
-size_t JSONNodeGetValueLength(JSONNode_t* pNode) {
-    size_t length;
-    switch (pNode->type) {
-        case JSONNullType: {
-            length = 4; // it's always just null
-            break;
-        }
-        case JSONBoolType: {
-            length = JSONBoolNodeGetValueLength(pNode);
-            break;
-        }
-        case JSONIntType: {
-            length = JSONIntNodeGetValueLength(pNode);
-            break;
-        }
-        case JSONFloatType: {
-            length = JSONFloatNodeGetValueLength(pNode);
-            break;
+static size_t JSONEncodeUtf8(char* pOut, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        pOut[0] = (char)codePoint;
+        return 1;
+    }
+    if (codePoint < 0x800) {
+        pOut[0] = (char)(0xC0 | (codePoint >> 6));
+        pOut[1] = (char)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint < 0x10000) {
+        pOut[0] = (char)(0xE0 | (codePoint >> 12));
+        pOut[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        pOut[2] = (char)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    pOut[0] = (char)(0xF0 | (codePoint >> 18));
+    pOut[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+    pOut[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+    pOut[3] = (char)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+/// @brief Parses the string starting at the current position, unescaping it where it is. Unescaping never makes a string longer,
+/// so it always fits, and it gets null-terminated where the closing quote (or an earlier byte of the original) was.
+/// Clean runs get skipped in bulk, and only strings with escapes get any bytes moved.
+/// @param ppStr Receives the unescaped string, inside the input
+/// @param pLength Receives its length
+static bool JSONParserString(JSONParser_t* pParser, char** ppStr, size_t* pLength) {
+    char* json = pParser->json;
+    size_t i = pParser->i + 1; // after the opening quote
+    size_t out = i;
+    char* pStr = json + i;
+    for (;;) {
+        size_t runLength = JSONFindEscape(json + i, pParser->length - i);
+        if (out != i) {
+            // out is always behind i, so copying forwards is safe even though the two overlap (and there's no memmove in jsonFuncs)
+            for (size_t k = 0; k < runLength; k++) {
+                json[out + k] = json[i + k];
+            }
         }
-        case JSONStringType: {
-            length = JSONStringNodeGetValueLength(pNode);
-            break;
+        i += runLength;
+        out += runLength;
+        if (i >= pParser->length) {
+            pParser->i = i;
+            return JSONParserFail(pParser, "Unterminated string");
         }
-        case JSONObjType: {
-            length = JSONObjNodeGetValueLength(pNode);
-            break;
+
+        char c = json[i];
+        if (c == STRING_DELIM) break;
+        if ((unsigned char)c < 0x20) {
+            pParser->i = i;
+            return JSONParserFail(pParser, "Control character in a string");
         }
-        case JSONArrayType: {
-            length = JSONArrayNodeGetValueLength(pNode);
-            break;
+
+        // backslash
+        if (i + 1 >= pParser->length) {
+            pParser->i = i;
+            return JSONParserFail(pParser, "Unterminated string");
         }
-        default: {
-            length = 0;
-            break;
+        char escaped = json[i + 1];
+        i += 2;
+        switch (escaped) {
+            case '"': json[out++] = '"'; break;
+            case '\\': json[out++] = '\\'; break;
+            case '/': json[out++] = '/'; break;
+            case 'b': json[out++] = '\b'; break;
+            case 'f': json[out++] = '\f'; break;
+            case 'n': json[out++] = '\n'; break;
+            case 'r': json[out++] = '\r'; break;
+            case 't': json[out++] = '\t'; break;
+            case 'u': {
+                uint32_t codePoint;
+                if (!JSONParserHex4(pParser, i, &codePoint)) {
+                    pParser->i = i;
+                    return JSONParserFail(pParser, "Invalid \\u escape");
+                }
+                i += 4;
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                    // a high surrogate, which only means something followed by a low one
+                    uint32_t low;
+                    if (pParser->length - i >= 6 && json[i] == '\\' && json[i + 1] == 'u' && JSONParserHex4(pParser, i + 2, &low) && low >= 0xDC00 && low <= 0xDFFF) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    } else {
+                        codePoint = 0xFFFD;
+                    }
+                } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                    codePoint = 0xFFFD; // a lone low surrogate
+                }
+                out += JSONEncodeUtf8(json + out, codePoint);
+                break;
+            }
+            default: {
+                pParser->i = i - 1;
+                return JSONParserFail(pParser, "Invalid escape");
+            }
         }
     }
-    return length;
-}
-/// @brief Gets the length of a node (key + ':' + value), recursing over JSONObjs and JSONArrays.
-/// @param pNode The node
-/// @return The length
-size_t JSONNodeGetLength(JSONNode_t* pNode) {
-    return JSONNodeGetPreValLength(pNode) + JSONNodeGetValueLength(pNode);
-}
-
-static void JSONNodeDumpPreVal(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    if (pNode->pParent == NULL) return;
-    if (pNode->pParent->type != JSONObjType) return;
 
-    pBuffer[*pPosition] = STRING_DELIM;
-    (*pPosition)++;
-
-    size_t nameLength = jsonFuncs.strlen(pNode->name);
-    (void)jsonFuncs.strncpy(pBuffer + *pPosition, pNode->name, nameLength);
-    (*pPosition) += nameLength;
-
-    pBuffer[*pPosition] = STRING_DELIM;
-    (*pPosition)++;
-    pBuffer[*pPosition] = KEYVAL_SEPARATOR;
-    (*pPosition)++;
-}
-static void JSONNodeNullValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    JsonAssert(pNode->type == JSONNullType);
-
-    (void)jsonFuncs.strncpy(pBuffer + *pPosition, "null", 4);
-    (*pPosition) += 4;
+    json[out] = '\0'; // the closing quote at the latest
+    *ppStr = pStr;
+    *pLength = (size_t)(json + out - pStr);
+    pParser->i = i + 1;
+    return true;
 }
-static void JSONNodeBoolValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    JsonAssert(pNode->type == JSONBoolType);
-
-    if (pNode->value.b) {
-        (void)jsonFuncs.strncpy(pBuffer + *pPosition, "true", 4);
-        (*pPosition) += 4;
-    } else {
-        (void)jsonFuncs.strncpy(pBuffer + *pPosition, "false", 5);
-        (*pPosition) += 5;
+/// @brief Parses a key and the ':' after it. Keys are null-terminated in place, so they can be used as node names as is.
+static bool JSONParserKey(JSONParser_t* pParser, const char** pName) {
+    if (pParser->i >= pParser->length || pParser->json[pParser->i] != STRING_DELIM) {
+        return JSONParserFail(pParser, "Expected a key");
     }
-}
-static void JSONNodeIntValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    JsonAssert(pNode->type == JSONIntType);
+    char* name;
+    size_t nameLength;
+    if (!JSONParserString(pParser, &name, &nameLength)) return false;
 
-    size_t length = JSONIntNodeGetValueLength(pNode);
-    (void)jsonFuncs.snprintf(pBuffer + *pPosition, length+1, "%d", pNode->value.i);
-    (*pPosition) += length;
+    pParser->i = JSONSkipWhitespace(pParser->json, pParser->length, pParser->i);
+    if (pParser->i >= pParser->length || pParser->json[pParser->i] != KEYVAL_SEPARATOR) {
+        return JSONParserFail(pParser, "Expected ':' after a key");
+    }
+    pParser->i = JSONSkipWhitespace(pParser->json, pParser->length, pParser->i + 1);
+    *pName = name;
+    return true;
 }
-static void JSONNodeFloatValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    JsonAssert(pNode->type == JSONFloatType);
-    
-    size_t length = JSONFloatNodeGetValueLength(pNode);
-    (void)jsonFuncs.snprintf(pBuffer + *pPosition, length+1, "%g", pNode->value.f);
-    (*pPosition) += length;
+/// @brief Multiplies a value by 10^exponent. Exact for the exponents that have a double power of 10, might be off by an ulp or so past them.
+static double JSONScaleByPowerOf10(double value, int exponent) {
+    while (exponent > JSON_PARSE_MAX_EXACT_POW10) {
+        value *= jsonDoublePowersOf10[JSON_PARSE_MAX_EXACT_POW10];
+        exponent -= JSON_PARSE_MAX_EXACT_POW10;
+    }
+    while (exponent < -JSON_PARSE_MAX_EXACT_POW10) {
+        value /= jsonDoublePowersOf10[JSON_PARSE_MAX_EXACT_POW10];
+        exponent += JSON_PARSE_MAX_EXACT_POW10;
+    }
+    return exponent >= 0 ? value * jsonDoublePowersOf10[exponent] : value / jsonDoublePowersOf10[-exponent];
 }
-static void JSONNodeStringValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    JsonAssert(pNode->type == JSONStringType);
-
-    const char* str = pNode->value.str;
-    size_t strLength = jsonFuncs.strlen(str);
-    
-    pBuffer[*pPosition] = STRING_DELIM;
-    (*pPosition)++;
-
-    (void)jsonFuncs.strncpy(pBuffer + *pPosition, str, strLength);
-    (*pPosition) += strLength;
+/// @brief Parses the number starting at the current position. Integers that fit in an int_type become int nodes, everything else doubles.
+/// The digits get accumulated in a single pass; numbers with at most 2^53 as their significand and a small enough power of 10 (most of them)
+/// convert exactly from there. The others go through jsonFuncs.strtod if it's set, and get scaled (possibly an ulp or so off) if it isn't.
+static bool JSONParserNumber(JSONParser_t* pParser, JSONType_t* pType, JSONValue_t* pValue) {
+    const char* json = pParser->json;
+    size_t start = pParser->i;
+    size_t end = JSONScanNumber(json, pParser->length, start);
+    if (end == start) return JSONParserFail(pParser, "Invalid value");
 
-    pBuffer[*pPosition] = STRING_DELIM;
-    (*pPosition)++;
-}
-static void JSONNodeObjValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    JsonAssert(pNode->type == JSONObjType);
+    size_t i = start;
+    bool bNegative = json[i] == '-';
+    if (bNegative) i++;
 
-    pBuffer[*pPosition] = JSONOBJ_START;
-    (*pPosition)++;
-    
-    JSONObj_t* jsonObj = pNode->value.pChildren;
-    if (!JSONObjIsEmpty(jsonObj)) {
-        JSONNode_t* current = jsonObj->pFirstChild;
-        while (current != NULL) {
-            JSONNodeDump(current, pBuffer, pPosition);
-            if (current != jsonObj->pLastChild) {
-                pBuffer[*pPosition] = CHILD_SEPARATOR;
-                (*pPosition)++;
+    uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool bTruncated = false;
+    bool bFraction = false;
+    bool bInteger = true;
+    for (; i < end; i++) {
+        char c = json[i];
+        if (c == '.') {
+            bFraction = true;
+            bInteger = false;
+            continue;
+        }
+        if (!JSONIsDigit(c)) break;
+        if (significantDigits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(c - '0');
+            if (mantissa != 0) significantDigits++;
+            if (bFraction) exponent--;
+        } else {
+            bTruncated = true; // 19 digits already have all the precision a double (or int64) can use
+            if (!bFraction) exponent++;
+        }
+    }
+    if (i < end) {
+        // exponent
+        bInteger = false;
+        i++;
+        bool bNegativeExponent = json[i] == '-';
+        if (json[i] == '+' || json[i] == '-') i++;
+        int explicitExponent = 0;
+        for (; i < end; i++) {
+            if (explicitExponent < 100000) {
+                explicitExponent = explicitExponent * 10 + (json[i] - '0');
             }
-            current = current->pNextSibling;
         }
+        exponent += bNegativeExponent ? -explicitExponent : explicitExponent;
     }
-    pBuffer[*pPosition] = JSONOBJ_END;
-    (*pPosition)++;
-}
-static void JSONNodeArrayValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JsonAssert(pBuffer != NULL);
-    JsonAssert(pNode->type == JSONArrayType);
+    pParser->i = end;
 
-    pBuffer[*pPosition] = JSONARRAY_START;
-    (*pPosition)++;
-    
-    JSONArray_t* jsonArray = pNode->value.pArray;
-    if (!JSONArrayIsEmpty(jsonArray)) {
-        JSONNode_t* current = jsonArray->pStart;
-        while (current != NULL) {
-            JSONNodeValueDump(current, pBuffer, pPosition);
-            if (current != jsonArray->pEnd) {
-                pBuffer[*pPosition] = CHILD_SEPARATOR;
-                (*pPosition)++;
+    if (bInteger && !bTruncated) {
+        const uint64_t intMax = ((uint64_t)1 << (sizeof(int_type) * 8 - 1)) - 1;
+        if (mantissa <= (bNegative ? intMax + 1 : intMax)) {
+            *pType = JSONIntType;
+            if (mantissa == 0) {
+                pValue->i = 0;
+            } else {
+                pValue->i = bNegative ? (int_type)(-(int64_t)(mantissa - 1) - 1) : (int_type)mantissa;
             }
-            current = current->pNextSibling;
+            return true;
         }
     }
-    pBuffer[*pPosition] = JSONARRAY_END;
-    (*pPosition)++;
+
+    double value;
+    if (!bTruncated && mantissa <= JSON_PARSE_MAX_EXACT_MANTISSA && exponent >= -JSON_PARSE_MAX_EXACT_POW10 && exponent <= JSON_PARSE_MAX_EXACT_POW10) {
+        value = JSONScaleByPowerOf10((double)mantissa, exponent);
+    } else if (mantissa == 0) {
+        value = 0.0;
+    } else if (pParser->pCtx->funcs.strtod != NULL && end - start < JSON_PARSE_MAX_STRTOD_CHARS) {
+        char number[JSON_PARSE_MAX_STRTOD_CHARS];
+        (void)pParser->pCtx->funcs.memcpy(number, json + start, end - start);
+        number[end - start] = '\0';
+        value = pParser->pCtx->funcs.strtod(number, NULL);
+        bNegative = false; // strtod got the sign
+    } else {
+        value = JSONScaleByPowerOf10((double)mantissa, exponent);
+    }
+    *pType = JSONDoubleType;
+    pValue->d = bNegative ? -value : value;
+    return true;
 }
+/// @brief Parses the value starting at the current position into a new node. For objects and arrays, that's just the opening bracket:
+/// their children get parsed (and linked to them) afterwards.
+/// @param name The node's key (inside the input), "" outside of objects
+/// @param depth How many objects/arrays the value is nested in
+static JSONNode_t* JSONParserValue(JSONParser_t* pParser, const char* name, size_t depth) {
+    if (pParser->i >= pParser->length) {
+        (void)JSONParserFail(pParser, "Expected a value");
+        return NULL;
+    }
 
-void JSONNodeValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    switch (pNode->type) {
-        case JSONNullType: {
-            JSONNodeNullValueDump(pNode, pBuffer, pPosition);
+    JSONType_t type;
+    JSONValue_t jsonValue;
+    (void)pParser->pCtx->funcs.memset(&jsonValue, 0, sizeof(JSONValue_t));
+    const char* json = pParser->json;
+    size_t i = pParser->i;
+    switch (json[i]) {
+        case JSONOBJ_START:
+        case JSONARRAY_START: {
+            if (depth >= pParser->pCtx->maxDepth) {
+                (void)JSONParserFail(pParser, "Nested deeper than the context's maxDepth");
+                return NULL;
+            }
+            type = json[i] == JSONOBJ_START ? JSONObjType : JSONArrayType;
+            pParser->i++;
             break;
         }
-        case JSONBoolType: {
-            JSONNodeBoolValueDump(pNode, pBuffer, pPosition);
+        case STRING_DELIM: {
+            char* str;
+            size_t strLength;
+            if (!JSONParserString(pParser, &str, &strLength)) return NULL;
+            type = JSONStringType;
+            jsonValue.str.pData = str;
+            jsonValue.str.length = strLength;
             break;
         }
-        case JSONIntType: {
-            JSONNodeIntValueDump(pNode, pBuffer, pPosition);
+        case 't':
+        case 'f':
+        case 'n': {
+            bool bTrue = JSONScanLiteral(json, pParser->length, i, "true", 4) != i;
+            bool bFalse = !bTrue && JSONScanLiteral(json, pParser->length, i, "false", 5) != i;
+            bool bNull = !bTrue && !bFalse && JSONScanLiteral(json, pParser->length, i, "null", 4) != i;
+            if (bNull) {
+                type = JSONNullType;
+                pParser->i += 4;
+            } else if (bTrue || bFalse) {
+                type = JSONBoolType;
+                jsonValue.b = bTrue;
+                pParser->i += bTrue ? 4 : 5;
+            } else {
+                (void)JSONParserFail(pParser, "Invalid value");
+                return NULL;
+            }
             break;
         }
-        case JSONFloatType: {
-            JSONNodeFloatValueDump(pNode, pBuffer, pPosition);
+        default: {
+            if (!JSONParserNumber(pParser, &type, &jsonValue)) return NULL;
             break;
         }
-        case JSONStringType: {
-            JSONNodeStringValueDump(pNode, pBuffer, pPosition);
-            break;
+    }
+    return JSONCtxCreateNode(pParser->pCtx, name, type, jsonValue);
+}
+/// @brief Links a freshly parsed node as the last child of the object/array being parsed. Lengths are left alone:
+/// the container adds up its children's once it's closed, instead of every child updating every ancestor.
+static void JSONParserAppend(JSONNode_t* pContainer, JSONNode_t* pChild) {
+    pChild->pParent = pContainer;
+    if (pContainer->type == JSONArrayType) {
+        JSONArray_t* pArray = &pContainer->value.array;
+        if (pArray->pEnd == NULL) {
+            pArray->pStart = pChild;
+        } else {
+            JSONNodeInsertAfter(pArray->pEnd, pChild);
         }
-        case JSONObjType: {
-            JSONNodeObjValueDump(pNode, pBuffer, pPosition);
-            break;
+        pArray->pEnd = pChild;
+        pArray->count++;
+    } else {
+        JSONObj_t* pChildren = &pContainer->value.children;
+        if (pChildren->pLastChild == NULL) {
+            pChildren->pFirstChild = pChild;
+        } else {
+            JSONNodeInsertAfter(pChildren->pLastChild, pChild);
         }
-        case JSONArrayType: {
-            JSONNodeArrayValueDump(pNode, pBuffer, pPosition);
-            break;
+        pChildren->pLastChild = pChild;
+        pChildren->count++;
+        // not interned: keys come from untrusted input, and interning them would grow the context's key table with every distinct one, for good.
+        // They already point into the input anyway. A parsed node gets interned like any other if it's moved into an object later.
+        pChild->pKey = NULL;
+    }
+}
+
+/// @brief Parses JSON into a tree of JSONNodes without copying any of it: strings get unescaped where they are, and keys and string values
+/// point into the input, which is why it has to be mutable and outlive the tree. Nodes come from the context's arena/pool/malloc like any others,
+/// so an arena makes parsing a whole document a handful of allocations. The tree can then be changed and dumped like one built by hand.
+/// Doesn't recurse. Objects/arrays nested deeper than the context's maxDepth make it fail.
+/// Keys are null-terminated in place, so a key containing \u0000 gets cut there. Duplicate keys are all kept.
+/// Keys aren't interned (see JSONCtxSetKeyInterning), so parsing documents with arbitrary keys doesn't grow the context's key table.
+/// @param pCtx The context the nodes get created in
+/// @param json The JSON. Gets modified. Doesn't have to be null-terminated.
+/// @param length Its length
+/// @param pError If not NULL, receives where and why parsing failed (message is NULL if it didn't)
+/// @return The root of the tree, or NULL if the input isn't valid JSON
+JSONNode_t* JSONCtxParseInSitu(JSONContext_t* pCtx, char* json, size_t length, JSONParseError_t* pError) {
+    JsonAssert(pCtx != NULL);
+    JsonAssert(json != NULL || length == 0);
+    JSONParser_t parser = { pCtx, json, length, 0, NULL };
+    JSONNode_t* pRoot = NULL;
+    JSONNode_t* pContainer = NULL; // the innermost object/array still open
+    size_t depth = 0;
+    bool bDone = false;
+
+    parser.i = JSONSkipWhitespace(json, length, 0);
+    while (!bDone) {
+        // a value starts here (after its key, in objects)
+        const char* name = "";
+        if (pContainer != NULL && pContainer->type == JSONObjType && !JSONParserKey(&parser, &name)) break;
+        JSONNode_t* pNode = JSONParserValue(&parser, name, depth);
+        if (pNode == NULL) break;
+        if (pContainer == NULL) {
+            pRoot = pNode;
+        } else {
+            JSONParserAppend(pContainer, pNode);
         }
-        default: {
-            // if you somehow manage to get a node with an invalid type then something has gone insanely terribly horribly wrong
-            // in which case one could say you deserve however many layers of UB are bound to arise from this,
-            // however since i'm a nice person I put an assert here so you could just end it right there
-            // before whatever fire your computer is on destroys the state of your program even further than it already has
-            JsonAssertMsg(false, "Tried to dump node of unknown type !");
+
+        if (JSONNodeCanHaveChildren(pNode)) {
+            pContainer = pNode;
+            depth++;
+            parser.i = JSONSkipWhitespace(json, length, parser.i);
+            char closing = pNode->type == JSONObjType ? JSONOBJ_END : JSONARRAY_END;
+            if (parser.i >= length || json[parser.i] != closing) continue; // its first child is next
+        }
+
+        // the value is done: close whatever ends here, until there's a next value (or nothing left)
+        for (;;) {
+            parser.i = JSONSkipWhitespace(json, length, parser.i);
+            if (pContainer == NULL) {
+                if (parser.i != length) (void)JSONParserFail(&parser, "Unexpected data after the JSON value");
+                bDone = true;
+                break;
+            }
+            if (parser.i >= length) {
+                (void)JSONParserFail(&parser, "Unterminated object or array");
+                break;
+            }
+
+            char c = json[parser.i];
+            if (c == CHILD_SEPARATOR) {
+                parser.i = JSONSkipWhitespace(json, length, parser.i + 1);
+                break;
+            }
+            if (c != (pContainer->type == JSONObjType ? JSONOBJ_END : JSONARRAY_END)) {
+                (void)JSONParserFail(&parser, "Expected ',' or the end of the object/array");
+                break;
+            }
+            parser.i++;
+            pContainer->valueLength = JSONNodeComputeValueLength(pContainer);
+            pContainer = pContainer->pParent;
+            depth--;
         }
+        if (parser.error != NULL) break;
     }
-}
 
-void JSONNodeDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition) {
-    JSONNodeDumpPreVal(pNode, pBuffer, pPosition);
-    JSONNodeValueDump(pNode, pBuffer, pPosition);
+    if (pError != NULL) {
+        pError->offset = parser.i;
+        pError->message = parser.error;
+    }
+    if (parser.error != NULL) {
+        if (pRoot != NULL) {
+            JSONNodeFreeTree(pRoot);
+        }
+        return NULL;
+    }
+    return pRoot;
 }
-
-/// @brief Recursively dumps a JSONNode
-/// @param pRoot The root of the tree to dump (or a single node if that's what you want to dump)
-/// @return The string representation of the JSON node. Must be freed.
-const char* JSONDump(JSONNode_t* pRoot) {
-    char* pBuffer = NULL;
-    int_type length = JSONNodeGetLength(pRoot);
-    pBuffer = (char*)jsonFuncs.malloc(length + 1);
-    int_type position = 0;
-    JSONNodeValueDump(pRoot, pBuffer, &position);
-    pBuffer[length] = '\0';
-    return (const char*)pBuffer;
+JSONNode_t* JSONParseInSitu(char* json, size_t length, JSONParseError_t* pError) {
+    return JSONCtxParseInSitu(&defaultContext, json, length, pError);
 }
+#pragma endregion
@@ -0,0 +1,436 @@
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#include "CJsonWrite/CJsonWrite.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Builds a few synthetic document shapes, and times building, dumping and destroying each of them.
+// Every shape comes from a fixed-seed generator, so two runs (or two commits) dump byte-identical documents.
+//
+// Usage: CJsonWriteBench [--json] [--scale N] [--reps N]
+//   --json   prints a single JSON document (written with JSONWriter_t) instead of a table, for diffing runs across commits
+//   --scale  multiplies the size of every shape (default 1, which dumps ~5-20 MB per shape)
+//   --reps   how many times each dump is repeated, the fastest one gets reported (default 5)
+
+#pragma region ALLOCATION_COUNTING
+static size_t allocCount;
+static size_t allocBytes;
+static size_t freeCount;
+
+static void* BenchMalloc(size_t size) {
+    allocCount++;
+    allocBytes += size;
+    return malloc(size);
+}
+static void BenchFree(void* p) {
+    if (p != NULL) {
+        freeCount++;
+    }
+    free(p);
+}
+static void BenchResetCounters() {
+    allocCount = 0;
+    allocBytes = 0;
+    freeCount = 0;
+}
+#pragma endregion
+
+#pragma region TIMING
+static double BenchNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+#pragma endregion
+
+#pragma region GENERATORS
+// xorshift64*, so every run generates the same documents regardless of the libc
+static uint64_t rngState;
+static void BenchSeed(uint64_t seed) {
+    rngState = seed;
+}
+static uint64_t BenchRandom() {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ull;
+}
+
+// Strings a shape points into. Nodes don't copy their strings, so these live until the tree is destroyed.
+typedef struct BenchStrings {
+    char** ppStrings;
+    size_t count;
+} BenchStrings_t;
+static char* BenchStringsAdd(BenchStrings_t* pStrings, size_t length) {
+    pStrings->ppStrings = (char**)realloc(pStrings->ppStrings, (pStrings->count + 1) * sizeof(char*));
+    char* str = (char*)malloc(length + 1);
+    pStrings->ppStrings[pStrings->count++] = str;
+    str[length] = '\0';
+    return str;
+}
+static void BenchStringsFree(BenchStrings_t* pStrings) {
+    for (size_t i = 0; i < pStrings->count; i++) {
+        free(pStrings->ppStrings[i]);
+    }
+    free(pStrings->ppStrings);
+    pStrings->ppStrings = NULL;
+    pStrings->count = 0;
+}
+
+/// @brief An object with many scalar members: a few thousand distinct keys that repeat, like a big table of records flattened into one object.
+static JSONNode_t* BenchBuildWideObject(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    const size_t keyCount = 4096;
+    char** ppKeys = (char**)malloc(keyCount * sizeof(char*));
+    for (size_t i = 0; i < keyCount; i++) {
+        ppKeys[i] = BenchStringsAdd(pStrings, 15);
+        snprintf(ppKeys[i], 16, "field_%08zu", i);
+    }
+
+    JSONNode_t* pRoot = JSONCtxCreateNewObjNode(pCtx);
+    for (size_t i = 0; i < 400000 * scale; i++) {
+        const char* key = ppKeys[BenchRandom() % keyCount];
+        switch (i % 4) {
+            case 0: JSONNodeAddNamedIntNode(pRoot, key, (int_type)(BenchRandom() % 1000000)); break;
+            case 1: JSONNodeAddNamedDoubleNode(pRoot, key, (double)(BenchRandom() % 1000000) / 1000.0); break;
+            case 2: JSONNodeAddNamedBoolNode(pRoot, key, BenchRandom() & 1); break;
+            default: JSONNodeAddNamedStringNode(pRoot, key, ppKeys[BenchRandom() % keyCount]); break;
+        }
+    }
+    free(ppKeys);
+    return pRoot;
+}
+/// @brief A metrics-like object: a few thousand counters, each added once and then updated by name over and over.
+static JSONNode_t* BenchBuildKeyedUpdates(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    const size_t keyCount = 4096;
+    char** ppKeys = (char**)malloc(keyCount * sizeof(char*));
+    for (size_t i = 0; i < keyCount; i++) {
+        ppKeys[i] = BenchStringsAdd(pStrings, 15);
+        snprintf(ppKeys[i], 16, "metric_%08zu", i);
+    }
+
+    JSONNode_t* pRoot = JSONCtxCreateNewObjNode(pCtx);
+    for (size_t i = 0; i < 1000000 * scale; i++) {
+        const char* key = ppKeys[BenchRandom() % keyCount];
+        if (i % 2 == 0) {
+            JSONObjNodeSetNamedInt(pRoot, key, (int_type)(BenchRandom() % 1000000));
+        } else {
+            JSONObjNodeSetNamedDouble(pRoot, key, (double)(BenchRandom() % 1000000) / 1000.0);
+        }
+    }
+    free(ppKeys);
+    return pRoot;
+}
+/// @brief Objects and arrays nested inside each other, each level holding a couple of scalars next to the next level.
+static JSONNode_t* BenchBuildDeepNesting(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    (void)pStrings;
+    // built from the innermost level out, so adding a child never has to update a long chain of ancestors
+    JSONNode_t* pInner = JSONCtxCreateNamedNullNode(pCtx, "");
+    for (size_t depth = 200000 * scale; depth > 0; depth--) {
+        JSONNode_t* pLevel;
+        if (depth % 2 == 0) {
+            pLevel = JSONCtxCreateNewObjNode(pCtx);
+            JSONNodeAddNamedIntNode(pLevel, "depth", (int_type)depth);
+            JSONNodeAddNamedStringNode(pLevel, "kind", "object");
+            JSONNodeSetName(pInner, "next");
+        } else {
+            pLevel = JSONCtxCreateNewArrayNode(pCtx);
+            JSONNodeAddIntNode(pLevel, (int_type)depth);
+        }
+        JSONNodeAdoptChildNode(pLevel, pInner);
+        pInner = pLevel;
+    }
+    return pInner;
+}
+/// @brief A flat array of ints spanning every magnitude.
+static JSONNode_t* BenchBuildIntArray(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    (void)pStrings;
+    JSONNode_t* pRoot = JSONCtxCreateNewArrayNode(pCtx);
+    for (size_t i = 0; i < 2000000 * scale; i++) {
+        uint64_t r = BenchRandom();
+        int_type value = (int_type)(r >> (r % 40 + 24));
+        JSONNodeAddIntNode(pRoot, (r & 1) ? value : -value);
+    }
+    return pRoot;
+}
+/// @brief The same ints as int_array, appended a batch at a time with JSONArrayNodeAppendInts.
+static JSONNode_t* BenchBuildBulkIntArray(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    (void)pStrings;
+    JSONNode_t* pRoot = JSONCtxCreateNewArrayNode(pCtx);
+    int_type batch[1024];
+    size_t batchCount = 0;
+    for (size_t i = 0; i < 2000000 * scale; i++) {
+        uint64_t r = BenchRandom();
+        int_type value = (int_type)(r >> (r % 40 + 24));
+        batch[batchCount++] = (r & 1) ? value : -value;
+        if (batchCount == sizeof(batch) / sizeof(batch[0])) {
+            JSONArrayNodeAppendInts(pRoot, batch, batchCount);
+            batchCount = 0;
+        }
+    }
+    JSONArrayNodeAppendInts(pRoot, batch, batchCount);
+    return pRoot;
+}
+/// @brief The same ints as int_array, in a single packed int array node filled a batch at a time.
+static JSONNode_t* BenchBuildPackedIntArray(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    (void)pStrings;
+    JSONNode_t* pRoot = JSONCtxCreateNamedIntArrayNode(pCtx, "", NULL, 0, true);
+    int_type batch[1024];
+    size_t batchCount = 0;
+    for (size_t i = 0; i < 2000000 * scale; i++) {
+        uint64_t r = BenchRandom();
+        int_type value = (int_type)(r >> (r % 40 + 24));
+        batch[batchCount++] = (r & 1) ? value : -value;
+        if (batchCount == sizeof(batch) / sizeof(batch[0])) {
+            JSONIntArrayNodeAppend(pRoot, batch, batchCount);
+            batchCount = 0;
+        }
+    }
+    JSONIntArrayNodeAppend(pRoot, batch, batchCount);
+    return pRoot;
+}
+/// @brief Arrays of [x, y, z] doubles, like coordinates or sensor samples.
+static JSONNode_t* BenchBuildFloatArray(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    (void)pStrings;
+    JSONNode_t* pRoot = JSONCtxCreateNewArrayNode(pCtx);
+    for (size_t i = 0; i < 300000 * scale; i++) {
+        JSONNode_t* pPoint = JSONCtxCreateNewArrayNode(pCtx);
+        for (int axis = 0; axis < 3; axis++) {
+            double value = (double)(int64_t)(BenchRandom() >> 11) / (double)(1ull << 40) - 4096.0;
+            JSONNodeAddDoubleNode(pPoint, value);
+        }
+        JSONNodeAdoptChildNode(pRoot, pPoint);
+    }
+    return pRoot;
+}
+/// @brief Objects holding long strings, mostly plain text with the occasional character that needs escaping.
+static JSONNode_t* BenchBuildLongStrings(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings) {
+    static const char text[] = "the quick brown fox jumps over the lazy dog 0123456789 ";
+    static const char special[] = "\"\\\n\t/";
+
+    JSONNode_t* pRoot = JSONCtxCreateNewArrayNode(pCtx);
+    for (size_t i = 0; i < 256 * scale; i++) {
+        size_t length = 32768 + BenchRandom() % 65536;
+        char* str = BenchStringsAdd(pStrings, length);
+        for (size_t c = 0; c < length; c++) {
+            uint64_t r = BenchRandom();
+            str[c] = (r % 200 == 0) ? special[(r >> 8) % (sizeof(special) - 1)] : text[c % (sizeof(text) - 1)];
+        }
+
+        JSONNode_t* pRecord = JSONCtxCreateNewObjNode(pCtx);
+        JSONNodeAddNamedIntNode(pRecord, "id", (int_type)i);
+        JSONNodeAddNamedStringNode(pRecord, "payload", str);
+        JSONNodeAdoptChildNode(pRoot, pRecord);
+    }
+    return pRoot;
+}
+#pragma endregion
+
+#pragma region RUNNER
+typedef JSONNode_t* (*BenchBuildFunc_t)(JSONContext_t* pCtx, size_t scale, BenchStrings_t* pStrings);
+typedef struct BenchShape {
+    const char* name;
+    BenchBuildFunc_t build;
+} BenchShape_t;
+typedef struct BenchResult {
+    const char* name;
+    size_t bytes;
+    double buildMs;
+    size_t buildAllocs;
+    size_t buildAllocBytes;
+    double dumpMs;          // fastest JSONDump
+    size_t dumpAllocs;      // per JSONDump
+    double scratchDumpMs;   // fastest JSONDumpToScratch, after a first one sized the scratch buffer
+    size_t scratchDumpAllocs;
+    double destroyMs;
+    size_t destroyFrees;
+} BenchResult_t;
+
+static const BenchShape_t shapes[] = {
+    { "wide_object", BenchBuildWideObject },
+    { "keyed_updates", BenchBuildKeyedUpdates },
+    { "deep_nesting", BenchBuildDeepNesting },
+    { "int_array", BenchBuildIntArray },
+    { "bulk_int_array", BenchBuildBulkIntArray },
+    { "packed_int_array", BenchBuildPackedIntArray },
+    { "float_array", BenchBuildFloatArray },
+    { "long_strings", BenchBuildLongStrings },
+};
+#define BENCH_SHAPE_COUNT (sizeof(shapes) / sizeof(shapes[0]))
+
+static double BenchMBPerSecond(size_t bytes, double ms) {
+    return ms > 0.0 ? (double)bytes / (1024.0 * 1024.0) / (ms / 1e3) : 0.0;
+}
+
+static void BenchRunShape(const BenchShape_t* pShape, const JSONFuncs_t* pFuncs, size_t scale, int reps, BenchResult_t* pResult) {
+    BenchStrings_t strings = { NULL, 0 };
+    pResult->name = pShape->name;
+
+    // a fresh context per shape, so no shape starts with node slabs or interned keys left over from the previous one
+    JSONContext_t ctx;
+    JSONContextInit(&ctx, pFuncs);
+    // the deep shape is far deeper than the default limit on purpose: dumping it must not depend on stack size
+    JSONCtxSetMaxDepth(&ctx, (size_t)-1);
+
+    BenchSeed(0x9E3779B97F4A7C15ull);
+    BenchResetCounters();
+    double start = BenchNow();
+    JSONNode_t* pRoot = pShape->build(&ctx, scale, &strings);
+    pResult->buildMs = BenchNow() - start;
+    pResult->buildAllocs = allocCount;
+    pResult->buildAllocBytes = allocBytes;
+    pResult->bytes = JSONNodeGetValueLength(pRoot);
+
+    pResult->dumpMs = 0.0;
+    for (int rep = 0; rep < reps; rep++) {
+        BenchResetCounters();
+        start = BenchNow();
+        const char* dump = JSONDump(pRoot);
+        double ms = BenchNow() - start;
+        pResult->dumpAllocs = allocCount;
+        if (dump == NULL) {
+            fprintf(stderr, "%s: dump failed\n", pShape->name);
+            exit(1);
+        }
+        pFuncs->free((void*)dump);
+        if (rep == 0 || ms < pResult->dumpMs) {
+            pResult->dumpMs = ms;
+        }
+    }
+
+    (void)JSONDumpToScratch(pRoot, NULL);
+    pResult->scratchDumpMs = 0.0;
+    for (int rep = 0; rep < reps; rep++) {
+        BenchResetCounters();
+        start = BenchNow();
+        (void)JSONDumpToScratch(pRoot, NULL);
+        double ms = BenchNow() - start;
+        pResult->scratchDumpAllocs = allocCount;
+        if (rep == 0 || ms < pResult->scratchDumpMs) {
+            pResult->scratchDumpMs = ms;
+        }
+    }
+
+    BenchResetCounters();
+    start = BenchNow();
+    JSONNodeDestroy(pRoot);
+    pResult->destroyMs = BenchNow() - start;
+    pResult->destroyFrees = freeCount;
+
+    JSONContextDestroy(&ctx);
+    BenchStringsFree(&strings);
+}
+#pragma endregion
+
+#pragma region REPORTING
+static void BenchPrintTable(const BenchResult_t* pResults, size_t count) {
+    printf("%-16s %10s %10s %12s %10s %10s %8s %10s %10s\n",
+        "shape", "MB", "build ms", "build allocs", "dump ms", "dump MB/s", "allocs", "scratch ms", "destroy ms");
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult_t* r = &pResults[i];
+        printf("%-16s %10.2f %10.2f %12zu %10.2f %10.1f %8zu %10.2f %10.2f\n",
+            r->name, (double)r->bytes / (1024.0 * 1024.0), r->buildMs, r->buildAllocs,
+            r->dumpMs, BenchMBPerSecond(r->bytes, r->dumpMs), r->dumpAllocs, r->scratchDumpMs, r->destroyMs);
+    }
+}
+static void BenchPrintJSON(const BenchResult_t* pResults, size_t count, size_t scale, int reps) {
+    JSONSink_t sink;
+    JSONSinkInitFile(&sink, stdout);
+    JSONBuffer_t buffer;
+    JSONBufferInitSink(&buffer, &sink, NULL, JSON_SINK_DEFAULT_CAPACITY);
+    JSONWriter_t writer;
+    JSONWriterInit(&writer, &buffer);
+
+    JSONWriterBeginObject(&writer);
+    JSONWriterKey(&writer, "scale");
+    JSONWriterDouble(&writer, (double)scale);
+    JSONWriterKey(&writer, "reps");
+    JSONWriterInt(&writer, reps);
+    JSONWriterKey(&writer, "shapes");
+    JSONWriterBeginArray(&writer);
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult_t* r = &pResults[i];
+        JSONWriterBeginObject(&writer);
+        JSONWriterKey(&writer, "name");
+        JSONWriterString(&writer, r->name);
+        // counts go through doubles, int_type may well be too small for them
+        JSONWriterKey(&writer, "bytes");
+        JSONWriterDouble(&writer, (double)r->bytes);
+        JSONWriterKey(&writer, "build_ms");
+        JSONWriterDouble(&writer, r->buildMs);
+        JSONWriterKey(&writer, "build_allocs");
+        JSONWriterDouble(&writer, (double)r->buildAllocs);
+        JSONWriterKey(&writer, "build_alloc_bytes");
+        JSONWriterDouble(&writer, (double)r->buildAllocBytes);
+        JSONWriterKey(&writer, "dump_ms");
+        JSONWriterDouble(&writer, r->dumpMs);
+        JSONWriterKey(&writer, "dump_mb_per_s");
+        JSONWriterDouble(&writer, BenchMBPerSecond(r->bytes, r->dumpMs));
+        JSONWriterKey(&writer, "dump_allocs");
+        JSONWriterDouble(&writer, (double)r->dumpAllocs);
+        JSONWriterKey(&writer, "scratch_dump_ms");
+        JSONWriterDouble(&writer, r->scratchDumpMs);
+        JSONWriterKey(&writer, "scratch_dump_mb_per_s");
+        JSONWriterDouble(&writer, BenchMBPerSecond(r->bytes, r->scratchDumpMs));
+        JSONWriterKey(&writer, "scratch_dump_allocs");
+        JSONWriterDouble(&writer, (double)r->scratchDumpAllocs);
+        JSONWriterKey(&writer, "destroy_ms");
+        JSONWriterDouble(&writer, r->destroyMs);
+        JSONWriterKey(&writer, "destroy_frees");
+        JSONWriterDouble(&writer, (double)r->destroyFrees);
+        JSONWriterEndObject(&writer);
+    }
+    JSONWriterEndArray(&writer);
+    JSONWriterEndObject(&writer);
+
+    (void)JSONWriterFlush(&writer);
+    JSONBufferDestroy(&buffer);
+    printf("\n");
+}
+#pragma endregion
+
+int main(int argc, char** argv) {
+    bool bJSON = false;
+    size_t scale = 1;
+    int reps = 5;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            bJSON = true;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--json] [--scale N] [--reps N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (scale < 1) scale = 1;
+    if (reps < 1) reps = 1;
+
+    JSONFuncs_t funcs = {
+        .malloc=BenchMalloc,
+        .free=BenchFree,
+        .memset=memset,
+        .strlen=strlen,
+        .snprintf=snprintf,
+        .strncpy=strncpy,
+        .memcpy=memcpy
+    };
+    CJsonWriteInit(&funcs);
+
+    BenchResult_t results[BENCH_SHAPE_COUNT];
+    for (size_t i = 0; i < BENCH_SHAPE_COUNT; i++) {
+        BenchRunShape(&shapes[i], &funcs, scale, reps, &results[i]);
+        if (!bJSON) {
+            fprintf(stderr, "%s done\n", shapes[i].name);
+        }
+    }
+
+    if (bJSON) {
+        BenchPrintJSON(results, BENCH_SHAPE_COUNT, scale, reps);
+    } else {
+        BenchPrintTable(results, BENCH_SHAPE_COUNT);
+    }
+    return 0;
+}
@@ -13,7 +13,9 @@ void CJsonWriteExample() {
         .memset=memset,
         .strlen=strlen,
         .snprintf=snprintf,
-        .strncpy=strncpy
+        .strncpy=strncpy,
+        .memcpy=memcpy,
+        .strtod=strtod // optional, the parser only needs it for the odd number it can't convert exactly by itself
     };
 
     // Initialize CJsonWrite with above functions
@@ -73,6 +75,66 @@ void CJsonWriteExample() {
 
     // Destroy the root of the tree, which will recursively free every node
     JSONNodeDestroy(pRoot);
+
+    // If you don't need to keep the tree around, you can also write the JSON directly without creating any nodes
+    JSONBuffer_t buffer;
+    JSONBufferInit(&buffer, 0);
+
+    JSONWriter_t writer;
+    JSONWriterInit(&writer, &buffer);
+
+    JSONWriterBeginObject(&writer);
+    JSONWriterKey(&writer, "an int");
+    JSONWriterInt(&writer, 55);
+    JSONWriterKey(&writer, "some array");
+    JSONWriterBeginArray(&writer);
+    JSONWriterString(&writer, "array element 1");
+    JSONWriterDouble(&writer, 5.55);
+    JSONWriterEndArray(&writer);
+    JSONWriterEndObject(&writer);
+
+    full = JSONBufferDetach(&buffer, NULL);
+    printf("%s\n", full);
+    jsonFuncs.free((void*)full);
+
+    // JSON can also be parsed back into a tree. The parser works in place (strings point into the input), so the input must be writable and outlive the tree
+    char input[] = "{\"an int\": 55, \"some array\": [\"array \\\"element\\\" 1\", 5.55, false]}";
+    JSONParseError_t error;
+    pRoot = JSONParseInSitu(input, strlen(input), &error);
+    if (pRoot == NULL) {
+        printf("parse error at %zu: %s\n", error.offset, error.message);
+        return;
+    }
+
+    // and the parsed tree is like any other one
+    JSONNodeAddNamedBoolNode(pRoot, "parsed", true);
+    full = JSONDump(pRoot);
+    printf("%s\n", full);
+    jsonFuncs.free((void*)full);
+    JSONNodeDestroy(pRoot);
+
+    // records that all have the same shape can skip the tree: compile the shape once into a template, then render each record from its values
+    pRoot = JSONCreateNewObjNode();
+    JSONNodeAddNamedIntNode(pRoot, "id", 0);
+    JSONNodeAddNamedStringNode(pRoot, "name", "");
+    JSONTemplate_t record;
+    (void)JSONTemplateCompile(&record, pRoot);
+    JSONNodeDestroy(pRoot);
+
+    JSONBuffer_t records;
+    JSONBufferInit(&records, 0);
+    const char* names[] = { "goomba", "koopa", "boo" };
+    for (int i = 0; i < 3; i++) {
+        JSONValue_t values[2]; // one per slot, in dump order
+        values[0].i = i;
+        values[1].str.pData = names[i];
+        values[1].str.length = strlen(names[i]);
+        JSONTemplateRender(&record, values, &records);
+        JSONBufferPutChar(&records, '\n');
+    }
+    printf("%.*s", (int)records.length, records.pData);
+    JSONBufferDestroy(&records);
+    JSONTemplateDestroy(&record);
 }
 int main() {
     CJsonWriteExample();
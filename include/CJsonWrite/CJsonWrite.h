@@ -6,7 +6,44 @@
 #ifndef __cplusplus
 #include <stdbool.h>
 #endif
+#include <stddef.h>
 #include "CJsonWrite/CJsonWrite_config.h"
+#ifndef JSON_ENABLE_STDIO
+#define JSON_ENABLE_STDIO 1
+#endif
+#ifndef JSON_ENABLE_POSIX
+#define JSON_ENABLE_POSIX 0
+#endif
+#ifndef JSON_ENABLE_SIMD
+#define JSON_ENABLE_SIMD 1
+#endif
+#ifndef JSON_INTERN_KEYS
+#define JSON_INTERN_KEYS 1
+#endif
+#ifndef JSON_MAX_INTERNED_KEYS
+#define JSON_MAX_INTERNED_KEYS 4096
+#endif
+#ifndef JSON_ENABLE_THREADS
+#define JSON_ENABLE_THREADS 0
+#endif
+#ifndef JSON_MAX_DEPTH
+#define JSON_MAX_DEPTH 1024
+#endif
+#ifndef JSON_ARRAY_INDEX_THRESHOLD
+#define JSON_ARRAY_INDEX_THRESHOLD 32
+#endif
+#ifndef JSON_OBJ_INDEX_THRESHOLD
+#define JSON_OBJ_INDEX_THRESHOLD 16
+#endif
+#ifndef JSON_ENABLE_STATS
+#define JSON_ENABLE_STATS 0
+#endif
+#ifndef JSON_VALIDATE_RAW
+#define JSON_VALIDATE_RAW 0
+#endif
+#if JSON_ENABLE_STDIO
+#include <stdio.h>
+#endif
 
 /// @brief Types of values that a JSONNode can have.
 typedef enum JSONType {
@@ -16,8 +53,60 @@ typedef enum JSONType {
     JSONFloatType,
     JSONStringType,
     JSONObjType,
-    JSONArrayType
+    JSONArrayType,
+    JSONDoubleType,
+    JSONIntArrayType, // packed array of int_type, see JSONPackedArray_t
+    JSONFloatArrayType, // packed array of float_type
+    JSONRawType // already serialized JSON, see JSONRaw_t
 } JSONType_t;
+// Number of JSONType_t values. Keep it in sync with the enum.
+#define JSON_TYPE_COUNT (JSONRawType + 1)
+
+/// @brief The children of a JSONObj node: a doubly-linked list containing a pointer to the first and last child,
+/// plus their number and (for big objects that get accessed by key) a hash index of their keys.
+/// When building one by hand to pass to JSONCreateObjNode, only pFirstChild and pLastChild need to be set.
+typedef struct JSONObj {
+    struct JSONNode* pFirstChild;
+    struct JSONNode* pLastChild;
+    size_t count;
+    struct JSONObjIndex* pIndex; // built lazily, see JSON_OBJ_INDEX_THRESHOLD
+} JSONObj_t;
+
+/// @brief This is the JSONValue type for a JSON array. It's just a linked list containing a pointer to the start and end,
+/// plus its number of elements and (for big arrays that get accessed by index) an index of its elements.
+/// When building one by hand to pass to JSONCreateArrayNode, only pStart and pEnd need to be set.
+typedef struct JSONArray {
+    struct JSONNode* pStart;
+    struct JSONNode* pEnd;
+    size_t count;
+    struct JSONArrayIndex* pIndex; // built lazily, see JSON_ARRAY_INDEX_THRESHOLD
+} JSONArray_t;
+
+/// @brief The value of a packed array node: plain numbers stored back to back instead of one node per element.
+/// Dumps like a regular array of ints/floats, but takes a fraction of the memory and gets formatted in one tight loop.
+/// Borrowed data isn't copied, so it must outlive the node (or its first append, which switches it over to a copy).
+typedef struct JSONPackedArray {
+    void* pData; // int_type* or float_type*, depending on the node's type
+    size_t count;
+    size_t capacity; // in elements. 0 for borrowed data.
+    bool bBorrowed; // pData is the caller's
+    bool bArena; // pData came from an arena, and goes away with it
+} JSONPackedArray_t;
+
+/// @brief The value of a string node. The length is measured once (or given) when the value is set, so the string doesn't have to be
+/// null-terminated and never gets strlen'd again. Borrowed strings must outlive the node; copied ones are freed along with it.
+typedef struct JSONString {
+    const char* pData;
+    size_t length;
+    bool bOwned; // pData was copied with the node's context malloc, and gets freed with the node
+} JSONString_t;
+
+/// @brief The value of a raw node: a JSON value that's already serialized (a cached sub-document, a payload received as is...).
+/// Sizing it is free and dumping it is a single copy. The bytes are trusted, not copied, so they must outlive the node.
+typedef struct JSONRaw {
+    const char* pData;
+    size_t length;
+} JSONRaw_t;
 
 /// @brief union type for the value of a JSONNode.
 /*
@@ -25,54 +114,231 @@ typedef enum JSONType {
  * The interesting ones are JSONNode and JSONArray, but actually they're also pretty self-explanatory.
  * JSONNode means the value of the node is a JSON object itself (the root is of type JSONNode, and so are elements of an array, etc.)
  * JSONArray means the value of the node is an array, and that array has a bunch of nodes inside it (or possibly none). It's just an array.
+ * Both of those are stored right inside the node, so a container is a single allocation and walking its children doesn't need an extra pointer hop.
 */
 typedef union JSONValue {
     bool b;
     int_type i;
     float_type f;
-    const char* str;
-    struct JSONObj* pChildren;
-    struct JSONArray* pArray;
+    double d;
+    JSONString_t str;
+    JSONObj_t children;
+    JSONArray_t array;
+    JSONPackedArray_t packed;
+    JSONRaw_t raw;
 } JSONValue_t;
 
+/// @brief Function pointers for CJsonWrite
+typedef struct JSONFuncs {
+    void* (*malloc)(size_t);
+    void (*free)(void*);
+    void* (*memset)(void*, int, size_t);
+    size_t (*strlen)(const char*);
+    int (*snprintf)(char*, size_t, const char*, ...);
+    char* (*strncpy)(char*, const char*, size_t);
+    void* (*memcpy)(void*, const void*, size_t); // optional, but set it: dumps copy a lot, and without it they fall back to a byte-by-byte loop
+    double (*strtod)(const char*, char**); // optional, only used by the parser for the rare numbers it can't convert exactly on its own
+} JSONFuncs_t;
+extern JSONFuncs_t jsonFuncs;
+
+struct JSONContext;
+
+/// @brief An interned object key: a context keeps one of these per distinct key, with the key already escaped and rendered as "key":
+/// so dumping it is a single copy.
+typedef struct JSONKey {
+    struct JSONKey* pNext; // next key in the same hash bucket
+    const char* name; // the context's own copy of the key
+    size_t nameLength;
+    const char* pFragment; // "key": (not null-terminated)
+    size_t fragmentLength;
+    uint32_t hash;
+} JSONKey_t;
+/// @brief Hash table of the keys interned by a context
+typedef struct JSONKeyTable {
+    JSONKey_t** ppBuckets;
+    size_t bucketCount; // always a power of 2
+    size_t keyCount;
+} JSONKeyTable_t;
+
 /// @brief The main man: this is a thing. Any actual attribute that a JSON tree can have is a JSONNode.
 /// The root of the tree is a JSONNode. A key-value pair attribute in a node is a JSONNode. Elements of a JSON array are JSONNodes.
 /// It has a name, a type (see JSONType), a value (see JSONValue), a pointer to its parent node, and pointers to its previous and next sibling nodes.
 /// A JSONNode should only ever be referenced once. Identical values should use separate JSONNodes.
+/// Every node knows the length of its dumped value. Change values through the JSONNodeSet* functions (not by writing to value directly)
+/// so that the lengths of its ancestors stay right.
 /// (the only exception is a JSONArray with only one element, in which case pStart and pEnd would point to the same JSONNode)
 typedef struct JSONNode {
     const char* name;
     JSONType_t type;
+    uint8_t flags; // JSON_NODE_FLAG_*
     JSONValue_t value;
     struct JSONNode* pParent;
     struct JSONNode* pPrevSibling;
     struct JSONNode* pNextSibling;
+    struct JSONContext* pCtx; // the context the node was created in, and the one it gets freed through
+    struct JSONNodePool* pPool; // the pool the node was allocated from (JSON_NODE_FLAG_POOL), which it goes back to
+    size_t valueLength; // length of the dumped value, kept up to date by every function that changes the tree
+    struct JSONBuffer* pDumpCache; // dumped bytes of the value, see JSONNodeSetDumpCache
+    const JSONKey_t* pKey; // the interned version of name, set while the node is in an object whose context interns keys (except for parsed nodes)
 } JSONNode_t;
 
-typedef struct JSONObj {
-    struct JSONNode* pFirstChild;
-    struct JSONNode* pLastChild;
-} JSONObj_t;
+// JSONNode flags
+#define JSON_NODE_FLAG_ARENA 0x01 // the node was allocated from a JSONArena_t and must not be freed on its own
+#define JSON_NODE_FLAG_POOL 0x02  // the node was allocated from a JSONNodePool_t and goes back to its free list
+#define JSON_NODE_FLAG_DIRTY 0x04 // something in the node's subtree changed since its dump cache was last filled
 
-/// @brief This is the JSONValue type for a JSON array. It's just a linked list containing a pointer to the start and end.
-typedef struct JSONArray {
-    JSONNode_t* pStart;
-    JSONNode_t* pEnd;
-} JSONArray_t;
+/// @brief A bump allocator for whole JSON trees. Nodes get carved out of big chunks, and the whole tree is released at once with JSONArenaReset
+/// instead of freeing nodes one by one. Great for trees that get built, dumped once and thrown away.
+typedef struct JSONArena {
+    struct JSONArenaChunk* pFirstChunk;
+    struct JSONArenaChunk* pCurrentChunk;
+    size_t chunkSize;
+    struct JSONContext* pCtx;
+} JSONArena_t;
+#define JSON_ARENA_DEFAULT_CHUNK_SIZE 16384
 
-/// @brief Function pointers for CJsonWrite
-typedef struct JSONFuncs {
-    void* (*malloc)(size_t);
-    void (*free)(void*);
-    void* (*memset)(void*, int, size_t);
-    size_t (*strlen)(const char*);
-    int (*snprintf)(char*, size_t, const char*, ...);
-    char* (*strncpy)(char*, const char*, size_t);
-} JSONFuncs_t;
-extern JSONFuncs_t jsonFuncs;
+/// @brief A slab allocator for JSONNodes. Nodes are carved out of slabs of a fixed number of nodes, and freed nodes go on a free list,
+/// so creating a node is just popping a pointer. Slabs only go back to the context's free when the pool is destroyed.
+typedef struct JSONNodePool {
+    struct JSONNodeSlab* pSlabs;
+    JSONNode_t* pFreeList; // linked through pNextSibling
+    size_t nodesPerSlab;
+    struct JSONContext* pCtx;
+} JSONNodePool_t;
+#define JSON_NODE_POOL_DEFAULT_SLAB_SIZE 64
+#ifndef JSON_NODE_POOL_SLAB_SIZE
+#define JSON_NODE_POOL_SLAB_SIZE JSON_NODE_POOL_DEFAULT_SLAB_SIZE
+#endif
+
+/// @brief Somewhere dumped JSON can be streamed to. write gets called with consecutive chunks of the output, and returns false if it failed.
+typedef struct JSONSink {
+    bool (*write)(void* pUserData, const char* pData, size_t length);
+    void* pUserData;
+} JSONSink_t;
+
+/// @brief Output buffer that JSONNodes get dumped into. By default it grows geometrically (through its context's malloc/free) as bytes get written to it,
+/// so a tree only has to be walked once to be dumped.
+/// If it has a sink, it's a fixed-size staging area instead, which gets flushed to the sink whenever it fills up.
+typedef struct JSONBuffer {
+    char* pData;
+    size_t length;
+    size_t capacity;
+    JSONSink_t* pSink;
+    bool bOwnsData;
+    bool bFailed;
+    struct JSONContext* pCtx;
+#if JSON_ENABLE_STATS
+    size_t maxDepth; // deepest nesting of objects/arrays walked while dumping into this buffer
+    struct JSONStats* pStats; // when set, what the buffer allocates gets counted here instead of in its context (JSONDumpParallel tasks)
+#endif
+} JSONBuffer_t;
+
+#if JSON_ENABLE_STATS
+/// @brief What a single dump did. Passed to the context's dump callback, and kept as the context's lastDump.
+typedef struct JSONDumpStats {
+    size_t length; // bytes of JSON produced
+    size_t maxDepth; // deepest nesting of objects/arrays walked (subtrees copied from a clean dump cache aren't walked)
+    uint64_t sizingTime; // getting the output ready: measuring the tree and allocating/mapping the output. In the unit of the context's clock, 0 without one.
+    uint64_t writingTime; // walking the tree and writing the output (including flushing it, for sinks)
+    bool bFailed;
+} JSONDumpStats_t;
+/// @brief Counters a context keeps when JSON_ENABLE_STATS is on. Everything is since the context was initialized, or since JSONCtxResetStats.
+typedef struct JSONStats {
+    size_t nodeCounts[JSON_TYPE_COUNT]; // live nodes, per JSONType_t
+    size_t liveNodes;
+    size_t peakNodes;
+    size_t liveBytes; // allocated through the context's malloc, and not freed (or handed over to the caller, like dump outputs) yet
+    size_t peakBytes;
+    size_t allocCount; // calls to the context's malloc
+    size_t dumpCount;
+    size_t failedDumpCount;
+    size_t dumpedBytes; // total length of every dump
+    size_t maxDepth; // deepest nesting any dump walked
+    JSONDumpStats_t lastDump;
+} JSONStats_t;
+typedef uint64_t (*JSONStatsClock_t)(void);
+typedef void (*JSONDumpCallback_t)(void* pUserData, const JSONDumpStats_t* pStats);
+#endif
 
-// For removing the last element of an array
-#define ARRAY_POS_END -1
+/// @brief Everything CJsonWrite would otherwise keep in globals: the function table, the active arena and node pool, and a scratch buffer for dumps.
+/// Every thread (or subsystem) can have its own, so they never share allocator state. Nodes remember the context they were created in.
+/// The functions without a pCtx parameter all use the default context, which CJsonWriteInit sets up.
+typedef struct JSONContext {
+    JSONFuncs_t funcs;
+    JSONArena_t* pArena; // nodes come from here when set
+    JSONNodePool_t* pPool; // otherwise from here when set (defaults to &pool)
+    JSONNodePool_t pool;
+    JSONBuffer_t scratch; // reused by JSONDumpToScratch
+    JSONKeyTable_t keys;
+    bool bInternKeys;
+    size_t maxDepth; // deepest nesting of objects/arrays a dump accepts
+#if JSON_ENABLE_STATS
+    JSONStats_t stats;
+    JSONStatsClock_t statsClock; // times dumps when set
+    JSONDumpCallback_t dumpCallback; // called at the end of every dump when set
+    void* pDumpCallbackData;
+#endif
+} JSONContext_t;
+
+/// @brief Where and why JSONParseInSitu failed.
+typedef struct JSONParseError {
+    size_t offset; // in the input
+    const char* message; // NULL if parsing succeeded
+} JSONParseError_t;
+
+#ifndef JSON_WRITER_MAX_DEPTH
+#define JSON_WRITER_MAX_DEPTH 32
+#endif
+/// @brief Writes JSON straight to a buffer without building a tree first, e.g. begin object, key, value, key, value, end object.
+/// The only state it keeps is one byte per nesting level, which it uses to place separators and to assert that the output stays valid JSON.
+/// Nesting deeper than JSON_WRITER_MAX_DEPTH, or any call that would make the output invalid JSON (a key outside of an object, a value without its key,
+/// a mismatched end...), makes it fail: every call after that does nothing, and JSONWriterIsComplete/JSONWriterFlush return false. Debug builds assert on the latter.
+typedef struct JSONWriter {
+    JSONBuffer_t* pBuffer;
+    uint8_t stack[JSON_WRITER_MAX_DEPTH];
+    size_t depth;
+    bool bComplete;
+    bool bFailed;
+} JSONWriter_t;
+
+/// @brief A record shape compiled from a tree (see JSONTemplateCompile): everything that's the same in every record (braces, keys, separators)
+/// is rendered once, and the values in between are typed slots. Rendering a record is then copying the static bytes and formatting the values.
+typedef struct JSONTemplate {
+    struct JSONContext* pCtx;
+    JSONBuffer_t staticBytes; // every static segment, back to back
+    struct JSONTemplateSlot* pSlots;
+    size_t slotCount;
+    size_t slotCapacity;
+} JSONTemplate_t;
+
+// For removing the last element of an array (indices are size_t, whatever int_type is)
+#define ARRAY_POS_END ((size_t)-1)
+
+// Capacity JSONDump starts with when it isn't given a hint. The buffer doubles whenever it runs out of space.
+#define JSON_DUMP_DEFAULT_CAPACITY 256
+// Size of the staging area JSONDumpToSink allocates when it isn't given one, and the smallest one it accepts
+#define JSON_SINK_DEFAULT_CAPACITY 4096
+#define JSON_SINK_MIN_CAPACITY 64
+// Size of the writes JSONDumpToFile falls back to when it can't map the file
+#define JSON_FILE_CHUNK_SIZE 65536
+// JSONDumpParallel never splits the work into pieces smaller than this, and dumps trees smaller than two of them on the calling thread.
+// Overridable so the tests can split small trees.
+#ifndef JSON_PARALLEL_MIN_TASK_SIZE
+#define JSON_PARALLEL_MIN_TASK_SIZE 16384
+#endif
+// Subtrees nested deeper than this are dumped whole by a single task instead of being split further
+#define JSON_PARALLEL_MAX_SPLIT_DEPTH 32
+// Room reserved in the output buffer before formatting a single number. Plenty for any int_type/float_type.
+#define JSON_NUMBER_MAX_CHARS 32
+// What JSONFormatFloat/JSONFormatDouble do with inf and nan, which JSON can't represent. Pick one in CJsonWrite_config.h with JSON_NONFINITE_POLICY.
+#define JSON_NONFINITE_NULL 0   // dumped as null
+#define JSON_NONFINITE_STRING 1 // dumped as the strings "Infinity", "-Infinity" and "NaN"
+#define JSON_NONFINITE_ASSERT 2 // JsonAssert fires, then falls back to null
+#ifndef JSON_NONFINITE_POLICY
+#define JSON_NONFINITE_POLICY JSON_NONFINITE_NULL
+#endif
+// Longest output of JSONFormatInt ("-9223372036854775808" with a 64-bit int_type)
+#define JSON_INT_MAX_CHARS 20
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,6 +346,37 @@ extern "C" {
 
 void CJsonWriteInit(JSONFuncs_t* _memory);
 
+void JSONContextInit(JSONContext_t* pCtx, const JSONFuncs_t* pFuncs);
+void JSONContextDestroy(JSONContext_t* pCtx);
+JSONContext_t* JSONGetDefaultContext();
+const JSONKey_t* JSONCtxInternKey(JSONContext_t* pCtx, const char* name);
+void JSONCtxSetKeyInterning(JSONContext_t* pCtx, bool bEnable);
+void JSONCtxSetMaxDepth(JSONContext_t* pCtx, size_t maxDepth);
+#if JSON_ENABLE_STATS
+const JSONStats_t* JSONCtxGetStats(JSONContext_t* pCtx);
+void JSONCtxResetStats(JSONContext_t* pCtx);
+void JSONCtxSetStatsClock(JSONContext_t* pCtx, JSONStatsClock_t clock);
+void JSONCtxSetDumpCallback(JSONContext_t* pCtx, JSONDumpCallback_t callback, void* pUserData);
+#endif
+
+void JSONCtxArenaInit(JSONContext_t* pCtx, JSONArena_t* pArena, size_t chunkSize);
+void JSONArenaInit(JSONArena_t* pArena, size_t chunkSize);
+void* JSONArenaAlloc(JSONArena_t* pArena, size_t size);
+void JSONArenaReset(JSONArena_t* pArena);
+void JSONArenaDestroy(JSONArena_t* pArena);
+void JSONSetArena(JSONArena_t* pArena);
+JSONArena_t* JSONGetArena();
+void JSONCtxSetArena(JSONContext_t* pCtx, JSONArena_t* pArena);
+JSONArena_t* JSONCtxGetArena(JSONContext_t* pCtx);
+
+void JSONCtxNodePoolInit(JSONContext_t* pCtx, JSONNodePool_t* pPool, size_t nodesPerSlab);
+void JSONNodePoolInit(JSONNodePool_t* pPool, size_t nodesPerSlab);
+void JSONNodePoolDestroy(JSONNodePool_t* pPool);
+void JSONSetNodePool(JSONNodePool_t* pPool);
+JSONNodePool_t* JSONGetNodePool();
+void JSONCtxSetNodePool(JSONContext_t* pCtx, JSONNodePool_t* pPool);
+JSONNodePool_t* JSONCtxGetNodePool(JSONContext_t* pCtx);
+
 bool JSONArrayIsValid(JSONArray_t* pArray);
 void JSONArrayMustBeValid(JSONArray_t* pArray);
 bool JSONArrayIsEmpty(JSONArray_t* pArray);
@@ -88,7 +385,19 @@ bool JSONObjIsValid(JSONObj_t* pObj);
 void JSONObjMustBeValid(JSONObj_t* pObj);
 bool JSONObjIsEmpty(JSONObj_t* pObj);
 size_t JSONArrayGetNumElements(JSONArray_t* pArray);
+size_t JSONObjGetNumChildren(JSONObj_t* pObj);
 bool JSONNodeCanHaveChildren(JSONNode_t* pNode);
+bool JSONNodeIsPackedArray(JSONNode_t* pNode);
+
+size_t JSONIntGetFormattedLength(int_type value);
+size_t JSONFormatInt(char* pOut, int_type value);
+
+size_t JSONFormatFloat(char* pOut, float value);
+size_t JSONFormatDouble(char* pOut, double value);
+
+size_t JSONGetEscapedLength(const char* str, size_t length);
+
+bool JSONValidate(const char* json, size_t length);
 
 void JSONNodeConnectNeighbors(JSONNode_t* pNode);
 void JSONNodeInsertAfter(JSONNode_t* pLeft, JSONNode_t* pNewNode);
@@ -96,63 +405,183 @@ void JSONNodeInsertAfter(JSONNode_t* pLeft, JSONNode_t* pNewNode);
 void JSONArrayDestroyElements(JSONArray_t* pArray);
 void JSONObjDestroyChildren(JSONObj_t* pObj);
 void JSONNodeDestroy(JSONNode_t* pNode);
+void JSONNodeDetach(JSONNode_t* pNode);
 
-JSONNode_t* JSONArrayGetNthNode(JSONArray_t* pArray, int_type n);
+JSONNode_t* JSONArrayGetNthNode(JSONArray_t* pArray, size_t n);
 void JSONArrayNodeAddNode(JSONNode_t* pArrayNode, JSONNode_t* pChild);
-void JSONArrayNodeRemoveNode(JSONNode_t* pArrayNode, int_type idx);
+void JSONArrayNodeAppendInts(JSONNode_t* pArrayNode, const int_type* pValues, size_t count);
+void JSONArrayNodeAppendFloats(JSONNode_t* pArrayNode, const float_type* pValues, size_t count);
+void JSONArrayNodeAppendDoubles(JSONNode_t* pArrayNode, const double* pValues, size_t count);
+void JSONArrayNodeAppendStrings(JSONNode_t* pArrayNode, const char* const* ppValues, size_t count);
+void JSONArrayNodeAppendNodes(JSONNode_t* pArrayNode, JSONNode_t* const* ppNodes, size_t count);
+void JSONArrayNodeInsertNode(JSONNode_t* pArrayNode, size_t idx, JSONNode_t* pChild);
+void JSONArrayNodeRemoveNode(JSONNode_t* pArrayNode, size_t idx);
 void JSONArrayNodeRemoveAllNodes(JSONNode_t* pNode);
 
 void JSONNodeAdoptChildNode(JSONNode_t* pParent, JSONNode_t* pChild);
+
+JSONNode_t* JSONObjGetChild(JSONObj_t* pObj, const char* name);
+void JSONObjNodeSetChild(JSONNode_t* pObjNode, JSONNode_t* pChild);
+bool JSONObjNodeRemoveChild(JSONNode_t* pObjNode, const char* name);
+void JSONObjNodeSetNamedBool(JSONNode_t* pObjNode, const char* name, bool value);
+void JSONObjNodeSetNamedInt(JSONNode_t* pObjNode, const char* name, int_type value);
+void JSONObjNodeSetNamedFloat(JSONNode_t* pObjNode, const char* name, float_type value);
+void JSONObjNodeSetNamedDouble(JSONNode_t* pObjNode, const char* name, double value);
+void JSONObjNodeSetNamedString(JSONNode_t* pObjNode, const char* name, const char* value);
+
+void JSONNodeSetName(JSONNode_t* pNode, const char* name);
+void JSONNodeSetNull(JSONNode_t* pNode);
+void JSONNodeSetBool(JSONNode_t* pNode, bool value);
+void JSONNodeSetInt(JSONNode_t* pNode, int_type value);
+void JSONNodeSetFloat(JSONNode_t* pNode, float_type value);
+void JSONNodeSetDouble(JSONNode_t* pNode, double value);
+void JSONNodeSetString(JSONNode_t* pNode, const char* value);
+void JSONNodeSetStringWithLength(JSONNode_t* pNode, const char* value, size_t length, bool bCopy);
+void JSONNodeSetRaw(JSONNode_t* pNode, const char* json, size_t length);
+void JSONNodeSetDumpCache(JSONNode_t* pNode, bool bEnable);
+JSONNode_t* JSONCtxCreateNode(JSONContext_t* pCtx, const char* name, JSONType_t type, JSONValue_t value);
 JSONNode_t* JSONCreateNode(const char* name, JSONType_t type, JSONValue_t value);
 
+JSONNode_t* JSONCtxCreateNamedNullNode(JSONContext_t* pCtx, const char* name);
+JSONNode_t* JSONCtxCreateNamedBoolNode(JSONContext_t* pCtx, const char* name, bool value);
+JSONNode_t* JSONCtxCreateNamedIntNode(JSONContext_t* pCtx, const char* name, int_type value);
+JSONNode_t* JSONCtxCreateNamedFloatNode(JSONContext_t* pCtx, const char* name, float_type value);
+JSONNode_t* JSONCtxCreateNamedDoubleNode(JSONContext_t* pCtx, const char* name, double value);
+JSONNode_t* JSONCtxCreateNamedStrNode(JSONContext_t* pCtx, const char* name, const char* value);
+JSONNode_t* JSONCtxCreateNamedStrNodeWithLength(JSONContext_t* pCtx, const char* name, const char* value, size_t length, bool bCopy);
+JSONNode_t* JSONCtxCreateNamedRawNode(JSONContext_t* pCtx, const char* name, const char* json, size_t length);
+JSONNode_t* JSONCtxCreateNewNamedObjNode(JSONContext_t* pCtx, const char* name);
+JSONNode_t* JSONCtxCreateNewNamedArrayNode(JSONContext_t* pCtx, const char* name);
+JSONNode_t* JSONCtxCreateNewObjNode(JSONContext_t* pCtx);
+JSONNode_t* JSONCtxCreateNewArrayNode(JSONContext_t* pCtx);
+JSONNode_t* JSONCtxCreateNamedIntArrayNode(JSONContext_t* pCtx, const char* name, const int_type* pValues, size_t count, bool bCopy);
+JSONNode_t* JSONCtxCreateNamedFloatArrayNode(JSONContext_t* pCtx, const char* name, const float_type* pValues, size_t count, bool bCopy);
+
 JSONNode_t* JSONCreateNamedNullNode(const char* name);
 JSONNode_t* JSONCreateNamedBoolNode(const char* name, bool value);
 JSONNode_t* JSONCreateNamedIntNode(const char* name, int_type value);
 JSONNode_t* JSONCreateNamedFloatNode(const char* name, float_type value);
+JSONNode_t* JSONCreateNamedDoubleNode(const char* name, double value);
 JSONNode_t* JSONCreateNamedStrNode(const char* name, const char* value);
+JSONNode_t* JSONCreateNamedStrNodeWithLength(const char* name, const char* value, size_t length, bool bCopy);
+JSONNode_t* JSONCreateNamedRawNode(const char* name, const char* json, size_t length);
 JSONNode_t* JSONCreateNewNamedObjNode(const char* name);
 JSONNode_t* JSONCreateNamedObjNode(const char* name, JSONObj_t* pObj);
 JSONNode_t* JSONCreateNewNamedArrayNode(const char* name);
 JSONNode_t* JSONCreateNamedArrayNode(const char* name, JSONArray_t* pArray);
+JSONNode_t* JSONCreateNamedIntArrayNode(const char* name, const int_type* pValues, size_t count, bool bCopy);
+JSONNode_t* JSONCreateNamedFloatArrayNode(const char* name, const float_type* pValues, size_t count, bool bCopy);
 
 JSONNode_t* JSONCreateNullNode();
 JSONNode_t* JSONCreateBoolNode(bool value);
 JSONNode_t* JSONCreateIntNode(int_type value);
 JSONNode_t* JSONCreateFloatNode(float_type value);
+JSONNode_t* JSONCreateDoubleNode(double value);
 JSONNode_t* JSONCreateStrNode(const char* value);
+JSONNode_t* JSONCreateStrNodeWithLength(const char* value, size_t length, bool bCopy);
+JSONNode_t* JSONCreateRawNode(const char* json, size_t length);
 JSONNode_t* JSONCreateNewObjNode();
 JSONNode_t* JSONCreateObjNode(JSONObj_t* pObj);
 JSONNode_t* JSONCreateNewArrayNode();
 JSONNode_t* JSONCreateArrayNode(JSONArray_t* pArray);
+JSONNode_t* JSONCreateIntArrayNode(const int_type* pValues, size_t count, bool bCopy);
+JSONNode_t* JSONCreateFloatArrayNode(const float_type* pValues, size_t count, bool bCopy);
 
 void JSONNodeAddNamedNullNode(JSONNode_t* pParent, const char* name);
 void JSONNodeAddNamedBoolNode(JSONNode_t* pParent, const char* name, bool value);
 void JSONNodeAddNamedIntNode(JSONNode_t* pParent, const char* name, int_type value);
 void JSONNodeAddNamedFloatNode(JSONNode_t* pParent, const char* name, float_type value);
+void JSONNodeAddNamedDoubleNode(JSONNode_t* pParent, const char* name, double value);
 void JSONNodeAddNamedStringNode(JSONNode_t* pNode, const char* name, const char* value);
+void JSONNodeAddNamedStringNodeWithLength(JSONNode_t* pParent, const char* name, const char* value, size_t length, bool bCopy);
+void JSONNodeAddNamedRawNode(JSONNode_t* pParent, const char* name, const char* json, size_t length);
 void JSONNodeAddNewNamedObjNode(JSONNode_t* pParent, const char* name);
 void JSONNodeAddNamedObjNode(JSONNode_t* pParent, const char* name, JSONObj_t* pObj);
 void JSONNodeAddNewNamedArrayNode(JSONNode_t* pParent, const char* name);
 void JSONNodeAddNamedArrayNode(JSONNode_t* pParent, const char* name, JSONArray_t* pArray);
+void JSONNodeAddNamedIntArrayNode(JSONNode_t* pParent, const char* name, const int_type* pValues, size_t count, bool bCopy);
+void JSONNodeAddNamedFloatArrayNode(JSONNode_t* pParent, const char* name, const float_type* pValues, size_t count, bool bCopy);
 
 void JSONNodeAddNullNode(JSONNode_t* pParent);
 void JSONNodeAddBoolNode(JSONNode_t* pParent, bool value);
 void JSONNodeAddIntNode(JSONNode_t* pParent, int_type value);
 void JSONNodeAddFloatNode(JSONNode_t* pParent, float_type value);
+void JSONNodeAddDoubleNode(JSONNode_t* pParent, double value);
 void JSONNodeAddStringNode(JSONNode_t* pNode, const char* value);
+void JSONNodeAddStringNodeWithLength(JSONNode_t* pParent, const char* value, size_t length, bool bCopy);
+void JSONNodeAddRawNode(JSONNode_t* pParent, const char* json, size_t length);
 void JSONNodeAddNewObjNode(JSONNode_t* pParent);
 void JSONNodeAddObjNode(JSONNode_t* pParent, JSONObj_t* pObj);
 void JSONNodeAddNewArrayNode(JSONNode_t* pParent);
 void JSONNodeAddArrayNode(JSONNode_t* pParent, JSONArray_t* pArray);
+void JSONNodeAddIntArrayNode(JSONNode_t* pParent, const int_type* pValues, size_t count, bool bCopy);
+void JSONNodeAddFloatArrayNode(JSONNode_t* pParent, const float_type* pValues, size_t count, bool bCopy);
+
+size_t JSONPackedArrayNodeGetCount(JSONNode_t* pNode);
+void JSONIntArrayNodeAppend(JSONNode_t* pNode, const int_type* pValues, size_t count);
+void JSONFloatArrayNodeAppend(JSONNode_t* pNode, const float_type* pValues, size_t count);
 
 size_t JSONNodeGetPreValLength(JSONNode_t* pNode);
 size_t JSONNodeGetValueLength(JSONNode_t* pNode);
 size_t JSONNodeGetLength(JSONNode_t* pNode);
 
-void JSONNodeValueDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition);
-void JSONNodeDump(JSONNode_t* pNode, char* pBuffer, int_type* pPosition);
+void JSONCtxBufferInit(JSONContext_t* pCtx, JSONBuffer_t* pBuffer, size_t capacity);
+void JSONCtxBufferInitSink(JSONContext_t* pCtx, JSONBuffer_t* pBuffer, JSONSink_t* pSink, char* pStaging, size_t stagingSize);
+void JSONBufferInit(JSONBuffer_t* pBuffer, size_t capacity);
+void JSONBufferInitSink(JSONBuffer_t* pBuffer, JSONSink_t* pSink, char* pStaging, size_t stagingSize);
+void JSONBufferDestroy(JSONBuffer_t* pBuffer);
+bool JSONBufferFlush(JSONBuffer_t* pBuffer);
+void JSONBufferReserve(JSONBuffer_t* pBuffer, size_t extra);
+void JSONBufferPutChar(JSONBuffer_t* pBuffer, char c);
+void JSONBufferWrite(JSONBuffer_t* pBuffer, const char* pData, size_t length);
+char* JSONBufferDetach(JSONBuffer_t* pBuffer, size_t* pOutLength);
+
+void JSONNodeValueDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer);
+void JSONNodeDump(JSONNode_t* pNode, JSONBuffer_t* pBuffer);
 
 const char* JSONDump(JSONNode_t* pRoot);
+const char* JSONDumpWithCapacityHint(JSONNode_t* pRoot, size_t capacityHint, size_t* pOutLength);
+const char* JSONDumpToScratch(JSONNode_t* pRoot, size_t* pOutLength);
+bool JSONDumpToSink(JSONNode_t* pRoot, JSONSink_t* pSink, char* pStaging, size_t stagingSize);
+#if JSON_ENABLE_THREADS
+const char* JSONDumpParallel(JSONNode_t* pRoot, size_t threadCount, size_t* pOutLength);
+#endif
+
+#if JSON_ENABLE_STDIO
+void JSONSinkInitFile(JSONSink_t* pSink, FILE* pFile);
+#endif
+#if JSON_ENABLE_POSIX
+void JSONSinkInitFd(JSONSink_t* pSink, int fd);
+bool JSONDumpToFile(JSONNode_t* pRoot, const char* path);
+#endif
+
+void JSONWriterInit(JSONWriter_t* pWriter, JSONBuffer_t* pBuffer);
+bool JSONWriterIsComplete(JSONWriter_t* pWriter);
+void JSONWriterBeginObject(JSONWriter_t* pWriter);
+void JSONWriterEndObject(JSONWriter_t* pWriter);
+void JSONWriterBeginArray(JSONWriter_t* pWriter);
+void JSONWriterEndArray(JSONWriter_t* pWriter);
+void JSONWriterKey(JSONWriter_t* pWriter, const char* key);
+void JSONWriterNull(JSONWriter_t* pWriter);
+void JSONWriterBool(JSONWriter_t* pWriter, bool value);
+void JSONWriterInt(JSONWriter_t* pWriter, int_type value);
+void JSONWriterFloat(JSONWriter_t* pWriter, float_type value);
+void JSONWriterDouble(JSONWriter_t* pWriter, double value);
+void JSONWriterString(JSONWriter_t* pWriter, const char* value);
+void JSONWriterStringWithLength(JSONWriter_t* pWriter, const char* value, size_t length);
+void JSONWriterRaw(JSONWriter_t* pWriter, const char* json, size_t length);
+bool JSONWriterFlush(JSONWriter_t* pWriter);
+void JSONWriterNode(JSONWriter_t* pWriter, JSONNode_t* pNode);
+void JSONWriterTemplate(JSONWriter_t* pWriter, const JSONTemplate_t* pTemplate, const JSONValue_t* pValues);
+
+bool JSONTemplateCompile(JSONTemplate_t* pTemplate, JSONNode_t* pRoot);
+void JSONTemplateDestroy(JSONTemplate_t* pTemplate);
+size_t JSONTemplateGetSlotCount(const JSONTemplate_t* pTemplate);
+JSONType_t JSONTemplateGetSlotType(const JSONTemplate_t* pTemplate, size_t slot);
+void JSONTemplateRender(const JSONTemplate_t* pTemplate, const JSONValue_t* pValues, JSONBuffer_t* pBuffer);
+
+JSONNode_t* JSONCtxParseInSitu(JSONContext_t* pCtx, char* json, size_t length, JSONParseError_t* pError);
+JSONNode_t* JSONParseInSitu(char* json, size_t length, JSONParseError_t* pError);
 
 #define JSONOBJ_START (char) '{'
 #define JSONOBJ_END (char) '}'
@@ -17,3 +17,61 @@
 
 typedef int32_t int_type;
 typedef float float_type;
+
+
+// JSON has no way to represent inf or nan. Pick what float/double nodes holding one of those get dumped as:
+// JSON_NONFINITE_NULL (null), JSON_NONFINITE_STRING ("Infinity", "-Infinity", "NaN") or JSON_NONFINITE_ASSERT (JsonAssert fires).
+#define JSON_NONFINITE_POLICY JSON_NONFINITE_NULL
+
+// How deep JSONWriter_t can nest objects/arrays. Each level costs one byte in the writer.
+#define JSON_WRITER_MAX_DEPTH 32
+
+// Set to 0 if your platform has no stdio.h. Enables JSONSinkInitFile (dumping to a FILE*).
+#define JSON_ENABLE_STDIO 1
+// Enables the features that need a POSIX system, like JSONSinkInitFd (dumping to a file descriptor). On by default on unix-likes.
+#if defined(__unix__) || defined(__APPLE__)
+#define JSON_ENABLE_POSIX 1
+#else
+#define JSON_ENABLE_POSIX 0
+#endif
+
+// How many JSONNodes the default node pool allocates at once. Set to 0 to allocate every node with jsonFuncs.malloc instead.
+#define JSON_NODE_POOL_SLAB_SIZE 64
+
+// Set to 0 to keep the string escaper from using SSE2/AVX2 intrinsics even when the compiler targets them. It then falls back to portable 8-bytes-at-a-time code.
+#define JSON_ENABLE_SIMD 1
+
+// Whether new contexts intern object keys (see JSONCtxInternKey). Each distinct key then gets measured, escaped and rendered once,
+// and dumps copy the rendered key in one go. Can also be changed per context with JSONCtxSetKeyInterning.
+// Interned keys are only freed with their context (and the default context is never destroyed), so the table only grows:
+// once a context holds JSON_MAX_INTERNED_KEYS keys, nodes with a key it doesn't have yet just aren't interned (they still dump the same).
+// That bounds it for processes that keep building trees keyed by ids. Set it to 0 for no limit.
+#define JSON_INTERN_KEYS 1
+#define JSON_MAX_INTERNED_KEYS 4096
+
+// Arrays with at least this many elements get a contiguous index of their elements the first time they're accessed by index,
+// making JSONArrayGetNthNode O(1) and indexed insertion/removal cheap. Set to 0 to never build one (saves memory).
+#define JSON_ARRAY_INDEX_THRESHOLD 32
+
+// Objects with at least this many children get a hash index of their keys the first time a child is looked up by name,
+// making JSONObjGetChild/JSONObjNodeSetChild/JSONObjNodeRemoveChild O(1). The children keep their order. Set to 0 to never build one.
+#define JSON_OBJ_INDEX_THRESHOLD 16
+
+// Enables JSONDumpParallel, which dumps big trees with several threads. Needs pthreads (link with -pthread). On by default on unix-likes.
+#define JSON_ENABLE_THREADS JSON_ENABLE_POSIX
+
+// How deeply objects/arrays can be nested in a tree that gets dumped. Dumps of deeper trees fail (JSONDump returns NULL) instead of running away.
+// Traversals don't recurse, so this doesn't protect the stack (nothing needs to), it just bounds what a dump accepts. Can be changed per context with JSONCtxSetMaxDepth.
+#define JSON_MAX_DEPTH 1024
+
+// Makes every context keep counters (live nodes per type, live/peak bytes, dumps, nesting depth) and time its dumps, see JSONCtxGetStats.
+// Off by default: when 0, none of it gets compiled in, and contexts/buffers don't even have the fields.
+#define JSON_ENABLE_STATS 0
+
+// Whether raw nodes (JSONRawType) and JSONWriterRaw check that their bytes are valid JSON, with JSONValidate. That's a full pass over the bytes,
+// so by default only debug builds do it. Either way the bytes are trusted when dumping.
+#ifndef NDEBUG
+#define JSON_VALIDATE_RAW 1
+#else
+#define JSON_VALIDATE_RAW 0
+#endif
@@ -0,0 +1,428 @@
+#include "CJsonWrite/CJsonWrite.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Checks the parts of the library that are easy to get subtly wrong: the parser on bad input and escapes,
+// JSONDumpParallel against JSONDump, and the object key index as children get renamed, removed and duplicated.
+// The Makefile builds the library with asserts on and a tiny JSON_PARALLEL_MIN_TASK_SIZE, so small trees get split too.
+//
+// Usage: CJsonWriteTest (exits with 1 if any check failed)
+
+#pragma region CHECKS
+static int checkCount;
+static int failCount;
+
+#define TEST_CHECK(condition) TestCheck((condition), #condition, __FILE__, __LINE__)
+
+static void TestCheck(bool bPassed, const char* condition, const char* file, int line) {
+    checkCount++;
+    if (!bPassed) {
+        failCount++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+    }
+}
+/// @brief Checks that a node dumps to exactly `expected`.
+static void TestCheckDump(JSONNode_t* pNode, const char* expected, const char* file, int line) {
+    const char* dumped = JSONDump(pNode);
+    bool bPassed = dumped != NULL && strcmp(dumped, expected) == 0;
+    TestCheck(bPassed, expected, file, line);
+    if (!bPassed) {
+        fprintf(stderr, "    got: %s\n", dumped != NULL ? dumped : "(NULL)");
+    }
+    jsonFuncs.free((void*)dumped);
+}
+#define TEST_CHECK_DUMP(pNode, expected) TestCheckDump((pNode), (expected), __FILE__, __LINE__)
+#pragma endregion
+
+#pragma region PARSER
+/// @brief Parses a copy of a string literal (the parser works in place). The copy is returned in ppBuffer and must outlive the tree.
+static JSONNode_t* TestParse(const char* json, char** ppBuffer, JSONParseError_t* pError) {
+    size_t length = strlen(json);
+    char* pBuffer = (char*)malloc(length + 1);
+    memcpy(pBuffer, json, length + 1);
+    *ppBuffer = pBuffer;
+    return JSONParseInSitu(pBuffer, length, pError);
+}
+
+static void TestParserMalformed() {
+    static const char* const malformed[] = {
+        "",
+        "   ",
+        "{",
+        "[",
+        "}",
+        "[1,",
+        "[1 2]",
+        "{\"a\"}",
+        "{\"a\":}",
+        "{\"a\" 1}",
+        "{a:1}",
+        "{\"a\":1,}",
+        "[1,]",
+        "{,}",
+        "[,]",
+        "[1]]",
+        "[1] x",
+        "tru",
+        "nul",
+        "falsey",
+        "-",
+        "1.",
+        ".5",
+        "1e",
+        "+1",
+        "\"abc",
+        "\"abc\\",
+        "\"\\x\"",
+        "\"\\u12G4\"",
+        "\"\\u12\"",
+        "\"a\tb\"",
+        "[\"a\nb\"]",
+        "{\"a\":[1,{\"b\":2]}",
+        "{\"a\":[1,{\"b\":2}}"
+    };
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        char* pBuffer;
+        JSONParseError_t error;
+        JSONNode_t* pRoot = TestParse(malformed[i], &pBuffer, &error);
+        TEST_CHECK(pRoot == NULL);
+        TEST_CHECK(error.message != NULL);
+        TEST_CHECK(error.offset <= strlen(malformed[i]));
+        if (pRoot != NULL) {
+            fprintf(stderr, "    parsed: \"%s\"\n", malformed[i]);
+            JSONNodeDestroy(pRoot);
+        }
+        free(pBuffer);
+    }
+
+    // the offset points at the problem
+    char* pBuffer;
+    JSONParseError_t error;
+    TEST_CHECK(TestParse("{\"a\":1 \"b\":2}", &pBuffer, &error) == NULL);
+    TEST_CHECK(error.offset == 7);
+    free(pBuffer);
+
+    // nesting deeper than the context's max depth fails instead of recursing
+    char deep[2 * 2000 + 1];
+    for (size_t i = 0; i < 2000; i++) {
+        deep[i] = '[';
+        deep[2000 + i] = ']';
+    }
+    deep[4000] = '\0';
+    TEST_CHECK(TestParse(deep, &pBuffer, &error) == NULL);
+    TEST_CHECK(error.message != NULL);
+    free(pBuffer);
+}
+
+static void TestParserEscapes() {
+    char* pBuffer;
+    JSONParseError_t error;
+    JSONNode_t* pRoot = TestParse("{\"simple\":\"a\\\"b\\\\c\\/d\\be\\ff\\ng\\rh\\ti\", "
+        "\"ascii\":\"\\u0041\\u007a\", \"two bytes\":\"\\u00e9\", \"three bytes\":\"\\u20AC\", "
+        "\"pair\":\"\\ud83d\\ude00\", \"lone high\":\"x\\ud800y\", \"lone low\":\"\\udc00\", \"high then high\":\"\\ud800\\ud800\", "
+        "\"k\\u00e9y\\n\":1, \"raw utf8\":\"\xc3\xa9\", \"empty\":\"\"}", &pBuffer, &error);
+    TEST_CHECK(pRoot != NULL);
+    TEST_CHECK(error.message == NULL);
+    if (pRoot == NULL) {
+        free(pBuffer);
+        return;
+    }
+
+    static const struct {
+        const char* key;
+        const char* value;
+    } expected[] = {
+        {"simple", "a\"b\\c/d\be\ff\ng\rh\ti"},
+        {"ascii", "Az"},
+        {"two bytes", "\xc3\xa9"},
+        {"three bytes", "\xe2\x82\xac"},
+        {"pair", "\xf0\x9f\x98\x80"},
+        {"lone high", "x\xef\xbf\xbdy"},
+        {"lone low", "\xef\xbf\xbd"},
+        {"high then high", "\xef\xbf\xbd\xef\xbf\xbd"},
+        {"raw utf8", "\xc3\xa9"},
+        {"empty", ""}
+    };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        JSONNode_t* pChild = JSONObjGetChild(&pRoot->value.children, expected[i].key);
+        TEST_CHECK(pChild != NULL && pChild->type == JSONStringType);
+        if (pChild != NULL && pChild->type == JSONStringType) {
+            TEST_CHECK(pChild->value.str.length == strlen(expected[i].value));
+            TEST_CHECK(memcmp(pChild->value.str.pData, expected[i].value, pChild->value.str.length) == 0);
+        }
+    }
+    JSONNode_t* pEscapedKey = JSONObjGetChild(&pRoot->value.children, "k\xc3\xa9y\n");
+    TEST_CHECK(pEscapedKey != NULL && pEscapedKey->type == JSONIntType && pEscapedKey->value.i == 1);
+    JSONNodeDestroy(pRoot);
+    free(pBuffer);
+
+    // dumping a parsed tree escapes everything again
+    pRoot = TestParse(" [ \"q\\\"\\\\\\/\\n\\u0001\" , true,false ,null, -12, 0.5, {}, [] ] ", &pBuffer, &error);
+    TEST_CHECK(pRoot != NULL);
+    if (pRoot != NULL) {
+        TEST_CHECK_DUMP(pRoot, "[\"q\\\"\\\\/\\n\\u0001\",true,false,null,-12,0.5,{},[]]");
+        JSONNodeDestroy(pRoot);
+    }
+    free(pBuffer);
+}
+#pragma endregion
+
+#pragma region PARALLEL_DUMP
+// Keys and strings the trees point into. Nodes don't copy them, so they live as long as the program.
+static char names[512][16];
+
+/// @brief Builds a tree with every kind of node, nested a few levels, big enough for JSON_PARALLEL_MIN_TASK_SIZE=64 to split it many times.
+static JSONNode_t* TestBuildTree(size_t width, size_t depth, size_t seed) {
+    JSONNode_t* pObj = JSONCreateNewObjNode();
+    for (size_t i = 0; i < width; i++) {
+        const char* name = names[(seed + i) % 512];
+        switch ((seed + i) % 9) {
+            case 0: JSONNodeAddNamedIntNode(pObj, name, (int_type)(seed * 31 + i) - 1000); break;
+            case 1: JSONNodeAddNamedStringNode(pObj, name, "esc\"aped \\ \n\t\x01 string"); break;
+            case 2: JSONNodeAddNamedDoubleNode(pObj, name, (double)i / 7.0); break;
+            case 3: JSONNodeAddNamedBoolNode(pObj, name, i % 2 == 0); break;
+            case 4: JSONNodeAddNamedNullNode(pObj, name); break;
+            case 5: {
+                int_type values[5] = {1, -2, 3, (int_type)i, (int_type)seed};
+                JSONNodeAdoptChildNode(pObj, JSONCreateNamedIntArrayNode(name, values, 5, true));
+                break;
+            }
+            case 6: {
+                JSONNode_t* pArray = JSONCreateNewNamedArrayNode(name);
+                for (size_t j = 0; j < i % 4; j++) {
+                    JSONNodeAddIntNode(pArray, (int_type)j);
+                    JSONNodeAddStringNode(pArray, names[j]);
+                }
+                JSONNodeAdoptChildNode(pObj, pArray);
+                break;
+            }
+            case 7: JSONNodeAdoptChildNode(pObj, JSONCreateNamedRawNode(name, "{\"raw\":[1,2]}", 13)); break;
+            default: {
+                if (depth > 0) {
+                    JSONNode_t* pChild = TestBuildTree(width / 2 + 1, depth - 1, seed * 7 + i);
+                    JSONNodeSetName(pChild, name);
+                    // some subtrees keep a dump cache, which the worker threads refill
+                    JSONNodeSetDumpCache(pChild, i % 3 == 0);
+                    JSONNodeAdoptChildNode(pObj, pChild);
+                } else {
+                    JSONNodeAdoptChildNode(pObj, JSONCreateNewNamedObjNode(name));
+                }
+                break;
+            }
+        }
+    }
+    return pObj;
+}
+static void TestCheckParallelMatches(JSONNode_t* pRoot) {
+    size_t length;
+    const char* expected = JSONDumpWithCapacityHint(pRoot, 0, &length);
+    TEST_CHECK(expected != NULL);
+    for (size_t threadCount = 1; threadCount <= 8; threadCount++) {
+        size_t parallelLength;
+        const char* parallel = JSONDumpParallel(pRoot, threadCount, &parallelLength);
+        TEST_CHECK(parallel != NULL);
+        TEST_CHECK(parallelLength == length);
+        TEST_CHECK(parallel != NULL && expected != NULL && strcmp(parallel, expected) == 0);
+        jsonFuncs.free((void*)parallel);
+    }
+    jsonFuncs.free((void*)expected);
+}
+
+static void TestParallelDump() {
+    for (size_t i = 0; i < 512; i++) {
+        (void)snprintf(names[i], sizeof(names[i]), "key%zu", i);
+    }
+
+    // a scalar and empty containers, which don't split
+    JSONNode_t* pScalar = JSONCreateIntNode(5);
+    TestCheckParallelMatches(pScalar);
+    JSONNodeDestroy(pScalar);
+    JSONNode_t* pEmpty = JSONCreateNewObjNode();
+    TestCheckParallelMatches(pEmpty);
+    JSONNodeAdoptChildNode(pEmpty, JSONCreateNewNamedArrayNode("a"));
+    TestCheckParallelMatches(pEmpty);
+    JSONNodeDestroy(pEmpty);
+
+    for (size_t seed = 1; seed <= 4; seed++) {
+        JSONNode_t* pRoot = TestBuildTree(24 * seed, 3, seed);
+        TestCheckParallelMatches(pRoot);
+        // again once the caches are full, then after changing the tree under a cached subtree
+        TestCheckParallelMatches(pRoot);
+        JSONObjNodeSetNamedInt(pRoot, "added", 42);
+        for (JSONNode_t* pChild = pRoot->value.children.pFirstChild; pChild != NULL; pChild = pChild->pNextSibling) {
+            if (pChild->type == JSONObjType) {
+                JSONObjNodeSetNamedString(pChild, "changed", "yes");
+            }
+        }
+        TestCheckParallelMatches(pRoot);
+        JSONNodeDestroy(pRoot);
+    }
+
+    // an array root, and a long flat one
+    JSONNode_t* pArray = JSONCreateNewArrayNode();
+    for (size_t i = 0; i < 300; i++) {
+        if (i % 50 == 0) {
+            JSONArrayNodeAddNode(pArray, TestBuildTree(10, 2, i));
+        } else {
+            JSONNodeAddIntNode(pArray, (int_type)i);
+        }
+    }
+    TestCheckParallelMatches(pArray);
+    JSONNodeDestroy(pArray);
+}
+#pragma endregion
+
+#pragma region OBJECT_INDEX
+/// @brief The first child with that name, found by walking the list: what JSONObjGetChild must agree with, indexed or not.
+static JSONNode_t* TestFindLinear(JSONNode_t* pObjNode, const char* name) {
+    for (JSONNode_t* pChild = pObjNode->value.children.pFirstChild; pChild != NULL; pChild = pChild->pNextSibling) {
+        if (strcmp(pChild->name, name) == 0) {
+            return pChild;
+        }
+    }
+    return NULL;
+}
+static void TestCheckLookups(JSONNode_t* pObjNode) {
+    for (size_t i = 0; i < 512; i++) {
+        TEST_CHECK(JSONObjGetChild(&pObjNode->value.children, names[i]) == TestFindLinear(pObjNode, names[i]));
+    }
+    for (JSONNode_t* pChild = pObjNode->value.children.pFirstChild; pChild != NULL; pChild = pChild->pNextSibling) {
+        TEST_CHECK(JSONObjGetChild(&pObjNode->value.children, pChild->name) == TestFindLinear(pObjNode, pChild->name));
+    }
+}
+
+/// @brief Runs the same edits on an object with `count` children, so objects under and over JSON_OBJ_INDEX_THRESHOLD both get checked.
+static void TestObjectIndex(size_t count) {
+    JSONNode_t* pObj = JSONCreateNewObjNode();
+    for (size_t i = 0; i < count; i++) {
+        JSONNodeAddNamedIntNode(pObj, names[i], (int_type)i);
+    }
+    TestCheckLookups(pObj);
+    JSONObj_t* pChildren = &pObj->value.children;
+
+    // rename to a new name
+    JSONNode_t* pRenamed = JSONObjGetChild(pChildren, names[1]);
+    JSONNodeSetName(pRenamed, "renamed");
+    TEST_CHECK(JSONObjGetChild(pChildren, names[1]) == NULL);
+    TEST_CHECK(JSONObjGetChild(pChildren, "renamed") == pRenamed);
+    TestCheckLookups(pObj);
+
+    // rename to the name of a later sibling: the renamed one comes first, so it's the one found
+    JSONNode_t* pSecond = JSONObjGetChild(pChildren, names[3]);
+    JSONNode_t* pFirst = JSONObjGetChild(pChildren, names[2]);
+    JSONNodeSetName(pFirst, names[3]);
+    TEST_CHECK(JSONObjGetChild(pChildren, names[3]) == pFirst);
+    TEST_CHECK(JSONObjGetChild(pChildren, names[2]) == NULL);
+    TestCheckLookups(pObj);
+    // and to the name of an earlier one: the earlier one is still found
+    JSONNode_t* pLast = JSONObjGetChild(pChildren, names[count - 1]);
+    JSONNodeSetName(pLast, "renamed");
+    TEST_CHECK(JSONObjGetChild(pChildren, "renamed") == pRenamed);
+    TEST_CHECK(JSONObjGetChild(pChildren, names[count - 1]) == NULL);
+    TestCheckLookups(pObj);
+
+    // removing the first of two duplicates uncovers the second
+    TEST_CHECK(JSONObjNodeRemoveChild(pObj, names[3]));
+    TEST_CHECK(JSONObjGetChild(pChildren, names[3]) == pSecond);
+    TEST_CHECK(JSONObjNodeRemoveChild(pObj, names[3]));
+    TEST_CHECK(JSONObjGetChild(pChildren, names[3]) == NULL);
+    TEST_CHECK(!JSONObjNodeRemoveChild(pObj, names[3]));
+    TEST_CHECK(JSONObjNodeRemoveChild(pObj, "renamed"));
+    TEST_CHECK(JSONObjGetChild(pChildren, "renamed") == pLast);
+    TestCheckLookups(pObj);
+
+    // duplicates added directly, then replaced by key: the first one gets replaced in place
+    JSONNodeAddNamedIntNode(pObj, "dup", 1);
+    JSONNodeAddNamedIntNode(pObj, "dup", 2);
+    TEST_CHECK(JSONObjGetChild(pChildren, "dup")->value.i == 1);
+    JSONObjNodeSetChild(pObj, JSONCreateNamedStrNode("dup", "replaced"));
+    JSONNode_t* pDup = JSONObjGetChild(pChildren, "dup");
+    TEST_CHECK(pDup != NULL && pDup->type == JSONStringType);
+    TEST_CHECK(pDup != NULL && pDup->pNextSibling != NULL && pDup->pNextSibling->value.i == 2);
+    JSONObjNodeSetNamedInt(pObj, "dup", 3);
+    TEST_CHECK(JSONObjGetChild(pChildren, "dup")->value.i == 3);
+    TestCheckLookups(pObj);
+
+    // removing every child one by one
+    size_t removed = 0;
+    while (pChildren->pFirstChild != NULL) {
+        const char* name = pChildren->pFirstChild->name;
+        TEST_CHECK(JSONObjNodeRemoveChild(pObj, name));
+        removed++;
+        if (removed % 5 == 0) {
+            TestCheckLookups(pObj);
+        }
+    }
+    TEST_CHECK(JSONObjGetNumChildren(pChildren) == 0);
+    TEST_CHECK_DUMP(pObj, "{}");
+    JSONNodeDestroy(pObj);
+}
+
+static void TestObjectIndexDump() {
+    // renames and removals keep the output in list order with the right keys
+    JSONNode_t* pObj = JSONCreateNewObjNode();
+    for (size_t i = 0; i < 20; i++) {
+        JSONNodeAddNamedIntNode(pObj, names[i], (int_type)i);
+    }
+    JSONObj_t* pChildren = &pObj->value.children;
+    (void)JSONObjGetChild(pChildren, names[0]);
+    for (size_t i = 0; i < 20; i++) {
+        if (i % 2 == 0) {
+            TEST_CHECK(JSONObjNodeRemoveChild(pObj, names[i]));
+        } else {
+            JSONNodeSetName(JSONObjGetChild(pChildren, names[i]), names[i - 1]);
+        }
+    }
+    TEST_CHECK_DUMP(pObj, "{\"key0\":1,\"key2\":3,\"key4\":5,\"key6\":7,\"key8\":9,\"key10\":11,\"key12\":13,\"key14\":15,\"key16\":17,\"key18\":19}");
+    TEST_CHECK(JSONObjGetChild(pChildren, names[18])->value.i == 19);
+    TEST_CHECK(JSONObjGetChild(pChildren, names[19]) == NULL);
+    JSONNodeDestroy(pObj);
+
+    // parsed duplicate keys are all kept, and the first one is found
+    char json[1024];
+    size_t length = 0;
+    length += (size_t)snprintf(json + length, sizeof(json) - length, "{\"a\":1");
+    for (size_t i = 0; i < 40; i++) {
+        length += (size_t)snprintf(json + length, sizeof(json) - length, ",\"k%zu\":%zu", i, i);
+    }
+    length += (size_t)snprintf(json + length, sizeof(json) - length, ",\"a\":2}");
+    char* pBuffer;
+    JSONParseError_t error;
+    pObj = TestParse(json, &pBuffer, &error);
+    TEST_CHECK(pObj != NULL);
+    if (pObj != NULL) {
+        TEST_CHECK(JSONObjGetNumChildren(&pObj->value.children) == 42);
+        TEST_CHECK(JSONObjGetChild(&pObj->value.children, "a")->value.i == 1);
+        TEST_CHECK(JSONObjNodeRemoveChild(pObj, "a"));
+        TEST_CHECK(JSONObjGetChild(&pObj->value.children, "a")->value.i == 2);
+        JSONNodeDestroy(pObj);
+    }
+    free(pBuffer);
+}
+#pragma endregion
+
+int main() {
+    JSONFuncs_t funcs = {
+        .malloc=malloc,
+        .free=free,
+        .memset=memset,
+        .strlen=strlen,
+        .snprintf=snprintf,
+        .strncpy=strncpy,
+        .memcpy=memcpy,
+        .strtod=strtod
+    };
+    CJsonWriteInit(&funcs);
+
+    TestParserMalformed();
+    TestParserEscapes();
+    TestParallelDump();
+    TestObjectIndex(8);
+    TestObjectIndex(JSON_OBJ_INDEX_THRESHOLD);
+    TestObjectIndex(200);
+    TestObjectIndexDump();
+
+    printf("%d checks, %d failed\n", checkCount, failCount);
+    return failCount == 0 ? 0 : 1;
+}